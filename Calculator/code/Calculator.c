@@ -1,268 +1,1457 @@
-/*
-=========================================
-   Interactive Terminal Calculator - C
-=========================================
-
-Supports:
-- Full expression parsing: e.g., (3 + 4) * 2 - 1
-- Operator precedence: +, -, *, /, %, ^ with parentheses
-- Unary functions: sqrt, abs, log, ln, exp, fact, sin, cos, tan
-- Special: Ans (last result), 'c' to clear screen, 'q' to quit
-
-Author: Vaggelis Papaioannou
-*/
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-#include <ctype.h>
-
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-
-#define MAX_TOKENS 100
-#define MAX_STACK 100
-
-typedef enum { NUMBER, OPERATOR, FUNCTION, PAREN_LEFT, PAREN_RIGHT } TokenType;
-
-typedef struct {
-    TokenType type;
-    double value;   // if NUMBER
-    char op;        // if OPERATOR
-    char func[10];  // if FUNCTION
-} Token;
-
-// Function prototypes
-double evaluate_expression(const char *expr, double last_result, int *error);
-int precedence(char op);
-int is_right_associative(char op);
-int is_function(const char *s);
-double apply_operator(char op, double a, double b, int *error);
-double apply_function(const char *func, double a, int *error);
-double factorial(int n);
-double degrees_to_radians(double deg);
-
-// Tokenization
-
-//Tokenization is the process of breaking down a math expression (like "3 + sqrt(4 * 2)") into individual elements, or tokens, that the calculator
-// can understand and manipulate programmatically.
-
-int tokenize(const char *expr, Token tokens[], double last_result) {
-    int count = 0;
-    const char *p = expr;
-
-    while (*p) {
-        if (isspace(*p)) { p++; continue; }
-
-        if (isdigit(*p) || (*p == '.' && isdigit(*(p+1)))) {
-            sscanf(p, "%lf", &tokens[count].value);
-            tokens[count].type = NUMBER;
-            while (isdigit(*p) || *p == '.') p++;
-            count++;
-        } else if (isalpha(*p)) {
-            char func[10] = {0};
-            int i = 0;
-            while (isalpha(*p)) func[i++] = *p++;
-            func[i] = '\0';
-
-            if (strcmp(func, "Ans") == 0) {
-                tokens[count].type = NUMBER;
-                tokens[count].value = last_result;
-                count++;
-            } else {
-                tokens[count].type = FUNCTION;
-                strcpy(tokens[count].func, func);
-                count++;
-            }
-        } else if (*p == '(') {
-            tokens[count++].type = PAREN_LEFT;
-            p++;
-        } else if (*p == ')') {
-            tokens[count++].type = PAREN_RIGHT;
-            p++;
-        } else if (strchr("+-*/%^", *p)) {
-            tokens[count].type = OPERATOR;
-            tokens[count++].op = *p++;
-        } else {
-            return -1; // invalid token
-        }
-    }
-
-    return count;
-}
-
-// Shunting Yard: Infix to Postfix
-
-/*
-
-This part of the code uses the Shunting Yard algorithm, invented by Edsger Dijkstra, 
-to convert a math expression written in infix notation (what humans write, like 3 + 4 * 2) 
-into postfix notation (what machines evaluate more easily, like 3 4 2 * +).
-
-*/
-int to_postfix(Token in[], int n, Token out[]) {
-    Token stack[MAX_STACK];
-    int out_i = 0, stack_i = 0;
-
-    for (int i = 0; i < n; i++) {
-        Token t = in[i];
-        if (t.type == NUMBER) {
-            out[out_i++] = t;
-        } else if (t.type == FUNCTION) {
-            stack[stack_i++] = t;
-        } else if (t.type == OPERATOR) {
-            while (stack_i > 0 && (
-                (stack[stack_i - 1].type == FUNCTION) ||
-                (stack[stack_i - 1].type == OPERATOR &&
-                 ((precedence(stack[stack_i - 1].op) > precedence(t.op)) ||
-                 (precedence(stack[stack_i - 1].op) == precedence(t.op) &&
-                  !is_right_associative(t.op))))
-            )) {
-                out[out_i++] = stack[--stack_i];
-            }
-            stack[stack_i++] = t;
-        } else if (t.type == PAREN_LEFT) {
-            stack[stack_i++] = t;
-        } else if (t.type == PAREN_RIGHT) {
-            while (stack_i > 0 && stack[stack_i - 1].type != PAREN_LEFT) {
-                out[out_i++] = stack[--stack_i];
-            }
-            if (stack_i == 0) return -1; // Mismatched parentheses
-            stack_i--; // Pop '('
-
-            if (stack_i > 0 && stack[stack_i - 1].type == FUNCTION)
-                out[out_i++] = stack[--stack_i];
-        }
-    }
-
-    while (stack_i > 0) {
-        if (stack[stack_i - 1].type == PAREN_LEFT) return -1;
-        out[out_i++] = stack[--stack_i];
-    }
-
-    return out_i;
-}
-
-// Evaluate Postfix
-double eval_postfix(Token tokens[], int n, int *error) {
-    double stack[MAX_STACK];
-    int top = 0;
-
-    for (int i = 0; i < n; i++) {
-        Token t = tokens[i];
-        if (t.type == NUMBER) {
-            stack[top++] = t.value;
-        } else if (t.type == OPERATOR) {
-            if (top < 2) { *error = 1; return 0; }
-            double b = stack[--top];
-            double a = stack[--top];
-            stack[top++] = apply_operator(t.op, a, b, error);
-        } else if (t.type == FUNCTION) {
-            if (top < 1) { *error = 1; return 0; }
-            double a = stack[--top];
-            stack[top++] = apply_function(t.func, a, error);
-        }
-    }
-
-    if (top != 1) { *error = 1; return 0; }
-    return stack[0];
-}
-
-// Expression evaluator
-double evaluate_expression(const char *expr, double last_result, int *error) {
-    Token tokens[MAX_TOKENS], postfix[MAX_TOKENS];
-    int ntokens = tokenize(expr, tokens, last_result);
-    if (ntokens < 0) { *error = 1; return 0; }
-
-    int npost = to_postfix(tokens, ntokens, postfix);
-    if (npost < 0) { *error = 1; return 0; }
-
-    return eval_postfix(postfix, npost, error);
-}
-
-// Helpers
-int precedence(char op) {
-    switch (op) {
-        case '+': case '-': return 1;
-        case '*': case '/': case '%': return 2;
-        case '^': return 3;
-        default: return 0;
-    }
-}
-int is_right_associative(char op) {
-    return op == '^';
-}
-double apply_operator(char op, double a, double b, int *error) {
-    switch (op) {
-        case '+': return a + b;
-        case '-': return a - b;
-        case '*': return a * b;
-        case '/': if (b == 0) { *error = 1; return 0; } return a / b;
-        case '%': if ((int)b == 0) { *error = 1; return 0; } return (int)a % (int)b;
-        case '^': return pow(a, b);
-        default: *error = 1; return 0;
-    }
-}
-double apply_function(const char *func, double a, int *error) {
-    if (strcmp(func, "sqrt") == 0) return a < 0 ? (*error = 1, 0) : sqrt(a);
-    if (strcmp(func, "abs") == 0) return fabs(a);
-    if (strcmp(func, "ln") == 0) return a <= 0 ? (*error = 1, 0) : log(a);
-    if (strcmp(func, "log") == 0) return a <= 0 ? (*error = 1, 0) : log10(a);
-    if (strcmp(func, "exp") == 0) return exp(a);
-    if (strcmp(func, "fact") == 0) return (a < 0 || floor(a) != a) ? (*error = 1, 0) : factorial((int)a);
-    if (strcmp(func, "sin") == 0) return sin(degrees_to_radians(a));
-    if (strcmp(func, "cos") == 0) return cos(degrees_to_radians(a));
-    if (strcmp(func, "tan") == 0) return tan(degrees_to_radians(a));
-    *error = 1;
-    return 0;
-}
-double factorial(int n) {
-    if (n < 0) return 0;
-    double res = 1;
-    for (int i = 2; i <= n; i++) res *= i;
-    return res;
-}
-double degrees_to_radians(double deg) {
-    return deg * M_PI / 180.0;
-}
-
-// Main program
-int main() {
-    char input[256];
-    double result = 0.0, last_result = 0.0;
-    int error;
-
-    printf("=== Terminal Calculator ===\n");
-    printf("Supports full expressions (e.g., (3 + 2) * 5 - 1 / 2)\n");
-    printf("Unary functions: sqrt, log, sin, fact, etc. | Use 'Ans' for last result\n");
-    printf("Type 'q' to quit, 'c' to clear screen.\n");
-
-    while (1) {
-        printf("\nEnter expression: ");
-        fgets(input, sizeof(input), stdin);
-        input[strcspn(input, "\n")] = 0;
-
-        if (strcmp(input, "q") == 0 || strcmp(input, "Q") == 0) {
-            printf("Goodbye!\n");
-            break;
-        }
-        if (strcmp(input, "c") == 0 || strcmp(input, "C") == 0) {
-            system("cls"); // Windows clear
-            continue;
-        }
-
-        error = 0;
-        result = evaluate_expression(input, last_result, &error);
-        if (error)
-            printf("Error: Invalid expression\n");
-        else {
-            printf("Result: %.6lf\n", result);
-            last_result = result;
-        }
-    }
-
-    return 0;
-}
+/*
+=========================================
+   Interactive Terminal Calculator - C
+=========================================
+
+Supports:
+- Full expression parsing: e.g., (3 + 4) * 2 - 1
+- Operator precedence: +, -, *, /, %, ^ with parentheses
+- Unary functions: sqrt, abs, log, ln, exp, fact, sin, cos, tan
+- Multi-argument functions: min, max, clamp, hypot (e.g. clamp(x, 0, 1))
+- More functions can be added at runtime with register_function()
+- Special: Ans (last result), 'c' to clear screen, 'q' to quit
+- Compiled expressions: compile a formula once (with named variables
+  such as x, y) and evaluate it many times against different bindings
+- Batch evaluation of a compiled expression over columns of inputs
+- Compiled expressions are optimized: constant subexpressions are folded,
+  identities (x*1, x+0, x^1) removed, x^2 and x^0.5 strength-reduced
+- Streaming mode for pipelines: calculator --stream [--format FMT]
+  reads one expression per line from stdin and writes one result per line
+- Parallel streaming: calculator --stream --threads N
+- No fixed limit on expression length: scratch buffers come from a
+  per-thread arena that is reused between evaluations
+
+Author: Vaggelis Papaioannou
+
+To compile:
+-----------------------------------
+gcc -O2 -o calculator Calculator.c -lm -pthread
+gcc -O2 -o calculator_bench calculator_bench.c -lm -pthread   (benchmarks)
+-----------------------------------
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DEG_TO_RAD (M_PI / 180.0)
+
+
+#define MAX_VARS 16
+#define MAX_NAME 16
+#define BATCH_LANES 256  // rows evaluated together per opcode in batch mode
+#define STREAM_BLOCK (1 << 20)  // bytes read from stdin / buffered for stdout in stream mode
+#define DEFAULT_FORMAT "%.6f"
+#define PARALLEL_CHUNK (4 << 20)  // bytes of input per worker thread per block
+#define STREAM_NO_MEMORY -1     // run_stream results below zero
+#define STREAM_READ_ERROR -2
+#define MAX_THREADS 256
+#define MAX_FUNCTIONS 64
+#define MAX_ARGS 4
+#define MAX_FACTORIAL 170     // 171! overflows a double
+#define MAX_INT_EXPONENT 64   // Whole-number bases to powers up to this use repeated squaring
+#define EXACT_INT_LIMIT 9007199254740992.0  // 2^53: every whole number below it is an exact double
+#define ARENA_MIN_BLOCK 4096
+#define ARENA_ALIGN 16
+
+// DUP and HALF_POW are only produced by optimize_postfix:
+// DUP pushes a copy of the top value (x^2 becomes x DUP *),
+// HALF_POW is x^0.5 computed with sqrt.
+typedef enum { NUMBER, OPERATOR, FUNCTION, PAREN_LEFT, PAREN_RIGHT, VARIABLE, COMMA,
+               DUP, HALF_POW } TokenType;
+
+typedef struct {
+    double value;        // if NUMBER
+    int id;              // function ID if FUNCTION, variable slot if VARIABLE
+    char op;             // if OPERATOR
+    unsigned char type;  // TokenType
+} Token;
+
+// Every function takes its arguments as an array and reports domain errors through *error
+typedef double (*CalcFunction)(const double args[], int *error);
+
+// Function names are resolved to an ID (index in this table) once, in tokenize
+typedef struct {
+    char name[MAX_NAME];
+    int arity;
+    CalcFunction fn;
+} FunctionDef;
+
+// A formula that has already been tokenized and converted to postfix.
+// Variables are given slots in order of first appearance; evaluate it
+// with an array of values where vars[slot] is the value of var_names[slot].
+// The program is heap-allocated by compile_expression; release it with free_compiled.
+typedef struct {
+    Token *program;
+    int length;
+    int depth;      // largest stack size the program reaches
+    int var_count;
+    char var_names[MAX_VARS][MAX_NAME];
+} CompiledExpr;
+
+// Bump allocator for the scratch buffers of one evaluation (tokens, postfix,
+// operator and value stacks). Blocks are chained when it runs out, so earlier
+// pointers stay valid; arena_reset merges them into one block big enough for
+// next time. Once it has grown to fit the longest expression seen, evaluations
+// do no heap allocation at all.
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+} Arena;
+
+// Function prototypes
+double evaluate_expression(const char *expr, double last_result, int *error);
+int compile_expression(const char *expr, CompiledExpr *ce);
+void free_compiled(CompiledExpr *ce);
+int optimize_postfix(Token tokens[], int n);
+int postfix_depth(const Token tokens[], int n);
+int find_variable(const CompiledExpr *ce, const char *name);
+double evaluate_compiled(const CompiledExpr *ce, const double vars[], int *error);
+size_t evaluate_batch(const CompiledExpr *ce, const double *const columns[], size_t n,
+                      double out[], int errors[]);
+int register_function(const char *name, int arity, CalcFunction fn);
+int find_function(const char *name);
+int precedence(char op);
+int is_right_associative(char op);
+double apply_operator(char op, double a, double b, int *error);
+double apply_function(int id, const double args[], int *error);
+double factorial(int n);
+double int_pow(double a, int n);
+double power(double a, double b);
+double degrees_to_radians(double deg);
+int parse_number(const char *p, double *value);
+double half_pow(double a);
+void *arena_alloc(Arena *a, size_t n);
+void arena_reset(Arena *a);
+void arena_free(Arena *a);
+Arena *thread_arena(void);
+int valid_format(const char *fmt);
+int run_stream(FILE *in, FILE *out, const char *format);
+int run_stream_parallel(FILE *in, FILE *out, const char *format, int threads);
+
+// Built-in functions
+double fn_sqrt(const double args[], int *error);
+double fn_abs(const double args[], int *error);
+double fn_ln(const double args[], int *error);
+double fn_log(const double args[], int *error);
+double fn_exp(const double args[], int *error);
+double fn_fact(const double args[], int *error);
+double fn_sin(const double args[], int *error);
+double fn_cos(const double args[], int *error);
+double fn_tan(const double args[], int *error);
+double fn_min(const double args[], int *error);
+double fn_max(const double args[], int *error);
+double fn_clamp(const double args[], int *error);
+double fn_hypot(const double args[], int *error);
+
+// Function table: built-ins first, register_function() appends after them
+FunctionDef functions[MAX_FUNCTIONS] = {
+    { "sqrt", 1, fn_sqrt }, { "abs", 1, fn_abs }, { "ln", 1, fn_ln },
+    { "log", 1, fn_log },   { "exp", 1, fn_exp }, { "fact", 1, fn_fact },
+    { "sin", 1, fn_sin },   { "cos", 1, fn_cos }, { "tan", 1, fn_tan },
+    { "min", 2, fn_min },   { "max", 2, fn_max }, { "clamp", 3, fn_clamp },
+    { "hypot", 2, fn_hypot }
+};
+int function_count = 13;
+
+// Number literals
+
+/*
+
+parse_number reads integers (42), decimals (3.14, .5, 2.) and scientific
+notation (1e-9, 6.02E23) in a single pass. The digits are collected into a
+64-bit integer; when that integer and the power of ten are both small enough
+to be exact doubles (at most 2^53 and 10^22), one multiplication or division
+gives the correctly rounded result. Anything else (very long mantissas, large
+exponents) is handed to strtod, which is slower but always correctly rounded.
+
+An 'e' only starts an exponent when digits follow it, so "2e" is the number 2
+followed by the name e.
+
+*/
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Parse the literal at p (which starts with a digit or '.') and return how many characters it used
+int parse_number(const char *p, double *value) {
+    const char *start = p;
+    uint64_t mantissa = 0;
+    int digits = 0;       // significant digits stored in mantissa
+    int dropped = 0;      // digits that did not fit (mantissa is then inexact)
+    int exp10 = 0;
+
+    while (*p == '0') p++;  // leading zeros are not significant
+    for (; isdigit((unsigned char)*p); p++) {
+        if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits++; }
+        else { exp10++; dropped |= (*p != '0'); }
+    }
+    if (*p == '.') {
+        p++;
+        if (digits == 0) {
+            while (*p == '0') { p++; exp10--; }
+        }
+        for (; isdigit((unsigned char)*p); p++) {
+            if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits++; exp10--; }
+            else dropped |= (*p != '0');
+        }
+    }
+    if (*p == 'e' || *p == 'E') {
+        const char *q = p + 1;
+        int sign = 1, e = 0;
+        if (*q == '+' || *q == '-') { sign = (*q == '-') ? -1 : 1; q++; }
+        if (isdigit((unsigned char)*q)) {
+            for (; isdigit((unsigned char)*q); q++) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+            }
+            exp10 += sign * e;
+            p = q;
+        }
+    }
+
+    int len = (int)(p - start);
+    if (mantissa == 0 && !dropped) {
+        *value = 0.0;
+    } else if (!dropped && mantissa <= (UINT64_C(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+        double m = (double)mantissa;
+        *value = exp10 < 0 ? m / powers_of_ten[-exp10] : m * powers_of_ten[exp10];
+    } else {
+        // slow path: strtod on a copy of exactly the characters we accepted
+        char small[64];
+        char *buf = len < (int)sizeof(small) ? small : malloc(len + 1);
+        if (!buf) { *value = HUGE_VAL; return len; }
+        memcpy(buf, start, len);
+        buf[len] = '\0';
+        *value = strtod(buf, NULL);
+        if (buf != small) free(buf);
+    }
+    return len;
+}
+
+// Tokenization
+
+//Tokenization is the process of breaking down a math expression (like "3 + sqrt(4 * 2)") into individual elements, or tokens, that the calculator
+// can understand and manipulate programmatically.
+
+// tokens must have room for strlen(expr) entries (every token uses at least one character).
+// When ce is NULL only known functions and Ans are accepted (Ans becomes a number).
+// When compiling, every other name (and Ans itself) becomes a VARIABLE with a slot in ce.
+int tokenize(const char *expr, Token tokens[], double last_result, CompiledExpr *ce) {
+    int count = 0;
+    const char *p = expr;
+
+    while (*p) {
+        if (isspace(*p)) { p++; continue; }
+
+        if (isdigit(*p) || (*p == '.' && isdigit(*(p+1)))) {
+            p += parse_number(p, &tokens[count].value);
+            tokens[count].type = NUMBER;
+            count++;
+        } else if (isalpha(*p) || *p == '_') {
+            char name[MAX_NAME] = {0};
+            int i = 0;
+            while (isalpha(*p) || *p == '_') {
+                if (i == MAX_NAME - 1) return -1; // name too long
+                name[i++] = *p++;
+            }
+            name[i] = '\0';
+
+            int id = find_function(name);
+            if (id >= 0) {
+                tokens[count].type = FUNCTION;
+                tokens[count].id = id;
+                count++;
+            } else if (ce == NULL && strcmp(name, "Ans") == 0) {
+                tokens[count].type = NUMBER;
+                tokens[count].value = last_result;
+                count++;
+            } else if (ce != NULL) {
+                int slot = find_variable(ce, name);
+                if (slot < 0) {
+                    if (ce->var_count == MAX_VARS) return -1; // too many variables
+                    slot = ce->var_count++;
+                    strcpy(ce->var_names[slot], name);
+                }
+                tokens[count].type = VARIABLE;
+                tokens[count].id = slot;
+                count++;
+            } else {
+                return -1; // unknown name
+            }
+        } else if (*p == '(') {
+            tokens[count++].type = PAREN_LEFT;
+            p++;
+        } else if (*p == ')') {
+            tokens[count++].type = PAREN_RIGHT;
+            p++;
+        } else if (*p == ',') {
+            tokens[count++].type = COMMA;
+            p++;
+        } else if (strchr("+-*/%^", *p)) {
+            tokens[count].type = OPERATOR;
+            tokens[count++].op = *p++;
+        } else {
+            return -1; // invalid token
+        }
+    }
+
+    return count;
+}
+
+// Shunting Yard: Infix to Postfix
+
+/*
+
+This part of the code uses the Shunting Yard algorithm, invented by Edsger Dijkstra, 
+to convert a math expression written in infix notation (what humans write, like 3 + 4 * 2) 
+into postfix notation (what machines evaluate more easily, like 3 4 2 * +).
+
+Commas separate the arguments of multi-argument functions such as max(a, b);
+the number of arguments is checked against the function's arity when the
+closing parenthesis is reached.
+
+out needs room for n tokens; the operator stack is taken from the scratch arena.
+
+*/
+int to_postfix(Token in[], int n, Token out[], Arena *scratch) {
+    Token *stack = arena_alloc(scratch, (n + 1) * sizeof(Token));
+    int *argc = arena_alloc(scratch, (n + 1) * sizeof(int));  // for '(' entries: arguments seen so far, -1 if not a function call
+    int out_i = 0, stack_i = 0;
+    if (!stack || !argc) return -1;
+
+    for (int i = 0; i < n; i++) {
+        Token t = in[i];
+        if (t.type == NUMBER || t.type == VARIABLE) {
+            out[out_i++] = t;
+        } else if (t.type == FUNCTION) {
+            // Only unary functions may be written without parentheses (e.g. sqrt 4)
+            if (functions[t.id].arity != 1 && (i + 1 >= n || in[i + 1].type != PAREN_LEFT))
+                return -1;
+            stack[stack_i++] = t;
+        } else if (t.type == OPERATOR) {
+            while (stack_i > 0 && (
+                (stack[stack_i - 1].type == FUNCTION) ||
+                (stack[stack_i - 1].type == OPERATOR &&
+                 ((precedence(stack[stack_i - 1].op) > precedence(t.op)) ||
+                 (precedence(stack[stack_i - 1].op) == precedence(t.op) &&
+                  !is_right_associative(t.op))))
+            )) {
+                out[out_i++] = stack[--stack_i];
+            }
+            stack[stack_i++] = t;
+        } else if (t.type == PAREN_LEFT) {
+            argc[stack_i] = (stack_i > 0 && stack[stack_i - 1].type == FUNCTION) ? 1 : -1;
+            stack[stack_i++] = t;
+        } else if (t.type == COMMA) {
+            while (stack_i > 0 && stack[stack_i - 1].type != PAREN_LEFT) {
+                out[out_i++] = stack[--stack_i];
+            }
+            if (stack_i == 0 || argc[stack_i - 1] < 0) return -1; // Comma outside a function call
+            argc[stack_i - 1]++;
+        } else if (t.type == PAREN_RIGHT) {
+            while (stack_i > 0 && stack[stack_i - 1].type != PAREN_LEFT) {
+                out[out_i++] = stack[--stack_i];
+            }
+            if (stack_i == 0) return -1; // Mismatched parentheses
+            int args = argc[--stack_i]; // Pop '('
+
+            if (stack_i > 0 && stack[stack_i - 1].type == FUNCTION) {
+                if (args >= 0 && args != functions[stack[stack_i - 1].id].arity) return -1;
+                out[out_i++] = stack[--stack_i];
+            }
+        }
+    }
+
+    while (stack_i > 0) {
+        if (stack[stack_i - 1].type == PAREN_LEFT) return -1;
+        out[out_i++] = stack[--stack_i];
+    }
+
+    return out_i;
+}
+
+// Evaluate Postfix
+// vars holds the values of VARIABLE slots (may be NULL if the program has none).
+// stack needs room for n values (or the program's depth, if known).
+double eval_postfix(const Token tokens[], int n, const double vars[], double stack[], int *error) {
+    int top = 0;
+
+    for (int i = 0; i < n; i++) {
+        Token t = tokens[i];
+        if (t.type == NUMBER) {
+            stack[top++] = t.value;
+        } else if (t.type == VARIABLE) {
+            stack[top++] = vars[t.id];
+        } else if (t.type == DUP) {
+            if (top < 1) { *error = 1; return 0; }
+            stack[top] = stack[top - 1];
+            top++;
+        } else if (t.type == HALF_POW) {
+            if (top < 1) { *error = 1; return 0; }
+            stack[top - 1] = half_pow(stack[top - 1]);
+        } else if (t.type == OPERATOR) {
+            if (top < 2) { *error = 1; return 0; }
+            double b = stack[--top];
+            double a = stack[--top];
+            stack[top++] = apply_operator(t.op, a, b, error);
+        } else if (t.type == FUNCTION) {
+            int arity = functions[t.id].arity;
+            if (top < arity) { *error = 1; return 0; }
+            top -= arity;
+            stack[top] = apply_function(t.id, &stack[top], error);
+            top++;
+        }
+    }
+
+    if (top != 1) { *error = 1; return 0; }
+    return stack[0];
+}
+
+// Expression evaluator
+// Scratch buffers come from the calling thread's arena, sized from the input length
+double evaluate_expression(const char *expr, double last_result, int *error) {
+    Arena *scratch = thread_arena();
+    size_t len = strlen(expr) + 1;
+    if (!scratch) { *error = 1; return 0; }
+    arena_reset(scratch);
+
+    Token *tokens = arena_alloc(scratch, len * sizeof(Token));
+    Token *postfix = arena_alloc(scratch, len * sizeof(Token));
+    if (!tokens || !postfix) { *error = 1; return 0; }
+
+    int ntokens = tokenize(expr, tokens, last_result, NULL);
+    if (ntokens < 0) { *error = 1; return 0; }
+
+    int npost = to_postfix(tokens, ntokens, postfix, scratch);
+    if (npost < 0) { *error = 1; return 0; }
+
+    double *stack = arena_alloc(scratch, (npost + 1) * sizeof(double));
+    if (!stack) { *error = 1; return 0; }
+    return eval_postfix(postfix, npost, NULL, stack, error);
+}
+
+// Compile once: tokenize + Shunting Yard, keeping the postfix program.
+// Returns 0 on success, -1 if the expression is invalid (or memory runs out).
+// A successfully compiled expression must be released with free_compiled.
+int compile_expression(const char *expr, CompiledExpr *ce) {
+    Arena *scratch = thread_arena();
+    size_t len = strlen(expr) + 1;
+    ce->program = NULL;
+    ce->length = 0;
+    ce->depth = 0;
+    ce->var_count = 0;
+    if (!scratch) return -1;
+    arena_reset(scratch);
+
+    Token *tokens = arena_alloc(scratch, len * sizeof(Token));
+    Token *postfix = arena_alloc(scratch, len * sizeof(Token));
+    if (!tokens || !postfix) return -1;
+
+    int ntokens = tokenize(expr, tokens, 0.0, ce);
+    if (ntokens < 0) return -1;
+
+    int npost = to_postfix(tokens, ntokens, postfix, scratch);
+    if (npost < 0) return -1;
+
+    npost = optimize_postfix(postfix, npost);
+    ce->program = malloc((npost + 1) * sizeof(Token));
+    if (!ce->program) return -1;
+    memcpy(ce->program, postfix, npost * sizeof(Token));
+    ce->length = npost;
+
+    // Invalid programs (e.g. "1 2") keep depth = length so evaluation still has room to fail cleanly
+    ce->depth = postfix_depth(ce->program, npost);
+    if (ce->depth < 0) ce->depth = npost;
+    return 0;
+}
+
+void free_compiled(CompiledExpr *ce) {
+    free(ce->program);
+    ce->program = NULL;
+    ce->length = 0;
+}
+
+// Constant folding and simplification
+
+/*
+
+optimize_postfix rewrites a postfix program in place so that it runs fewer opcodes:
+- operators and functions whose operands are all constants are computed once
+  (e.g. "180 3 /" becomes "60"), unless doing so raises an error - those are
+  left in the program so evaluation still reports them (1/0, sqrt(-1), ...)
+- x*1, 1*x, x/1, x+0, 0+x, x-0 and x^1 become just x
+- x^2 becomes x DUP * and x^0.5 becomes x HALF_POW
+
+Operations are never reordered, so results are bit-for-bit what the original
+program gives (the one exception: dropping +0 keeps -0 as -0 instead of 0).
+Every function in the table is assumed to be pure (same arguments, same result).
+
+*/
+
+// What we know about a value on the simulated stack
+typedef struct {
+    int start;     // index in the output program where this value's code begins
+    int is_const;  // 1 if the value is a known constant (a single NUMBER token)
+    double value;  // the constant, if is_const
+} FoldEntry;
+
+// Returns the new program length. Programs that would underflow are returned unchanged.
+int optimize_postfix(Token tokens[], int n) {
+    FoldEntry *st = malloc((n + 1) * sizeof(FoldEntry));
+    int top = 0, out = 0;
+    if (!st) return n;  // no memory: run the program unoptimized
+
+    for (int i = 0; i < n; i++) {
+        Token t = tokens[i];
+
+        if (t.type == NUMBER || t.type == VARIABLE) {
+            st[top].start = out;
+            st[top].is_const = (t.type == NUMBER);
+            st[top].value = t.value;
+            top++;
+            tokens[out++] = t;
+        } else if (t.type == FUNCTION) {
+            int arity = functions[t.id].arity;
+            if (top < arity) { free(st); return n; }
+
+            int all_const = 1;
+            double args[MAX_ARGS];
+            for (int k = 0; k < arity; k++) {
+                all_const &= st[top - arity + k].is_const;
+                args[k] = st[top - arity + k].value;
+            }
+
+            top -= arity;
+            int start = st[top].start;
+            int err = 0;
+            double v = all_const ? apply_function(t.id, args, &err) : 0;
+
+            if (all_const && !err) {
+                out = start;
+                tokens[out].type = NUMBER;
+                tokens[out].value = v;
+                out++;
+            } else {
+                tokens[out++] = t;
+            }
+            st[top].start = start;
+            st[top].is_const = all_const && !err;
+            st[top].value = v;
+            top++;
+        } else if (t.type == OPERATOR) {
+            if (top < 2) { free(st); return n; }
+            FoldEntry a = st[top - 2], b = st[top - 1];
+            top--;
+
+            if (a.is_const && b.is_const) {
+                int err = 0;
+                double v = apply_operator(t.op, a.value, b.value, &err);
+                if (!err) {
+                    out = a.start;
+                    tokens[out].type = NUMBER;
+                    tokens[out].value = v;
+                    out++;
+                    st[top - 1].value = v;
+                    continue;
+                }
+            } else if (b.is_const) {
+                if (((t.op == '*' || t.op == '/' || t.op == '^') && b.value == 1) ||
+                    ((t.op == '+' || t.op == '-') && b.value == 0)) {
+                    out = b.start;  // drop the constant and the operator
+                    continue;
+                }
+                if (t.op == '^' && (b.value == 2 || b.value == 0.5)) {
+                    out = b.start;
+                    if (b.value == 2) {
+                        tokens[out].type = DUP;
+                        out++;
+                        tokens[out].type = OPERATOR;
+                        tokens[out].op = '*';
+                        out++;
+                    } else {
+                        tokens[out].type = HALF_POW;
+                        out++;
+                    }
+                    st[top - 1].is_const = 0;
+                    continue;
+                }
+            } else if (a.is_const) {
+                if ((t.op == '*' && a.value == 1) || (t.op == '+' && a.value == 0)) {
+                    // drop the constant: move b's code down over it
+                    memmove(&tokens[a.start], &tokens[b.start], (out - b.start) * sizeof(Token));
+                    out -= b.start - a.start;
+                    st[top - 1].is_const = 0;
+                    continue;
+                }
+            }
+
+            tokens[out++] = t;
+            st[top - 1].is_const = 0;
+        } else {
+            tokens[out++] = t;  // DUP / HALF_POW are not produced by to_postfix
+        }
+    }
+
+    free(st);
+    return out;
+}
+
+// Slot of a named variable in a compiled expression, or -1 if it is not used
+int find_variable(const CompiledExpr *ce, const char *name) {
+    for (int i = 0; i < ce->var_count; i++) {
+        if (strcmp(ce->var_names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+// Evaluate many times: only the postfix stage runs
+double evaluate_compiled(const CompiledExpr *ce, const double vars[], int *error) {
+    Arena *scratch = thread_arena();
+    if (!scratch) { *error = 1; return 0; }
+    arena_reset(scratch);
+
+    double *stack = arena_alloc(scratch, (ce->depth + 1) * sizeof(double));
+    if (!stack) { *error = 1; return 0; }
+    return eval_postfix(ce->program, ce->length, vars, stack, error);
+}
+
+// Batch evaluation
+
+/*
+
+Instead of running the whole postfix program once per row, the batch evaluator
+runs each opcode once per block of BATCH_LANES rows. The stack holds one column
+of BATCH_LANES doubles per entry, so every operator becomes a simple loop over
+contiguous arrays that the compiler can vectorize.
+
+*/
+
+// Stack depth the program needs, or -1 if it would underflow or leave extra values
+int postfix_depth(const Token tokens[], int n) {
+    int top = 0, max = 0;
+    for (int i = 0; i < n; i++) {
+        if (tokens[i].type == NUMBER || tokens[i].type == VARIABLE || tokens[i].type == DUP) {
+            if (tokens[i].type == DUP && top < 1) return -1;
+            top++;
+        }
+        else if (tokens[i].type == HALF_POW) { if (top < 1) return -1; }
+        else if (tokens[i].type == OPERATOR) { if (top < 2) return -1; top--; }
+        else if (tokens[i].type == FUNCTION) {
+            int arity = functions[tokens[i].id].arity;
+            if (top < arity) return -1;
+            top -= arity - 1;
+        }
+        if (top > max) max = top;
+    }
+    return top == 1 ? max : -1;
+}
+
+// a[j] = a[j] op b[j] for every lane, flagging lanes that hit an error
+static void apply_operator_lanes(char op, double *restrict a, const double *restrict b,
+                                 int *restrict err, int n) {
+    switch (op) {
+        case '+': for (int j = 0; j < n; j++) a[j] = a[j] + b[j]; break;
+        case '-': for (int j = 0; j < n; j++) a[j] = a[j] - b[j]; break;
+        case '*': for (int j = 0; j < n; j++) a[j] = a[j] * b[j]; break;
+        case '/':
+            for (int j = 0; j < n; j++) {
+                err[j] |= (b[j] == 0);
+                a[j] = b[j] == 0 ? 0 : a[j] / b[j];
+            }
+            break;
+        case '%':
+            for (int j = 0; j < n; j++) {
+                int ib = (int)b[j];
+                err[j] |= (ib == 0);
+                a[j] = ib == 0 ? 0 : (int)a[j] % (ib == 0 ? 1 : ib);
+            }
+            break;
+        case '^': for (int j = 0; j < n; j++) a[j] = power(a[j], b[j]); break;
+        default:  for (int j = 0; j < n; j++) err[j] = 1;
+    }
+}
+
+// Evaluate a compiled expression for n rows at once.
+// columns[slot] points to n input values for variable slot; out receives n results.
+// errors (may be NULL) receives 1 for each row that failed, 0 otherwise.
+// Failed rows get 0 in out. Returns the number of failed rows.
+size_t evaluate_batch(const CompiledExpr *ce, const double *const columns[], size_t n,
+                      double out[], int errors[]) {
+    int depth = postfix_depth(ce->program, ce->length);
+    Arena *scratch = thread_arena();
+    double *stack = NULL;
+    if (depth >= 0 && scratch) {
+        arena_reset(scratch);
+        stack = arena_alloc(scratch, (size_t)depth * BATCH_LANES * sizeof(double));
+    }
+    if (!stack) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = 0;
+            if (errors) errors[i] = 1;
+        }
+        return n;
+    }
+
+    size_t failed = 0;
+    int err[BATCH_LANES];
+
+    for (size_t start = 0; start < n; start += BATCH_LANES) {
+        int lanes = (n - start < BATCH_LANES) ? (int)(n - start) : BATCH_LANES;
+        int top = 0;
+        memset(err, 0, sizeof(err));
+
+        for (int i = 0; i < ce->length; i++) {
+            const Token *t = &ce->program[i];
+            double *col = stack + (size_t)top * BATCH_LANES;
+
+            if (t->type == NUMBER) {
+                for (int j = 0; j < lanes; j++) col[j] = t->value;
+                top++;
+            } else if (t->type == VARIABLE) {
+                memcpy(col, columns[t->id] + start, lanes * sizeof(double));
+                top++;
+            } else if (t->type == DUP) {
+                memcpy(col, col - BATCH_LANES, lanes * sizeof(double));
+                top++;
+            } else if (t->type == HALF_POW) {
+                double *a = col - BATCH_LANES;
+                for (int j = 0; j < lanes; j++) a[j] = half_pow(a[j]);
+            } else if (t->type == OPERATOR) {
+                double *a = col - 2 * BATCH_LANES;
+                double *b = col - BATCH_LANES;
+                apply_operator_lanes(t->op, a, b, err, lanes);
+                top--;
+            } else if (t->type == FUNCTION) {
+                int arity = functions[t->id].arity;
+                CalcFunction fn = functions[t->id].fn;  // resolved once per opcode, not per row
+                double *a = col - (size_t)arity * BATCH_LANES;
+                double args[MAX_ARGS];
+                for (int j = 0; j < lanes; j++) {
+                    for (int k = 0; k < arity; k++) args[k] = a[(size_t)k * BATCH_LANES + j];
+                    a[j] = fn(args, &err[j]);
+                }
+                top -= arity - 1;
+            }
+        }
+
+        for (int j = 0; j < lanes; j++) {
+            out[start + j] = err[j] ? 0 : stack[j];
+            if (errors) errors[start + j] = err[j];
+            failed += err[j];
+        }
+    }
+
+    return failed;
+}
+
+// Scratch arena
+
+static size_t align_up(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// Data starts right after the (aligned) block header
+#define ARENA_HEADER align_up(sizeof(ArenaBlock))
+
+void *arena_alloc(Arena *a, size_t n) {
+    n = align_up(n ? n : 1);
+    ArenaBlock *b = a->head;
+    if (!b || b->used + n > b->size) {
+        size_t size = b ? b->size * 2 : ARENA_MIN_BLOCK;
+        if (size < n) size = n;
+        b = malloc(ARENA_HEADER + size);
+        if (!b) return NULL;
+        b->next = a->head;
+        b->size = size;
+        b->used = 0;
+        a->head = b;
+    }
+    void *p = (char *)b + ARENA_HEADER + b->used;
+    b->used += n;
+    return p;
+}
+
+// Forget everything allocated; if the last evaluation needed several blocks,
+// replace them with one block as large as all of them together
+void arena_reset(Arena *a) {
+    ArenaBlock *b = a->head;
+    if (!b) return;
+    if (b->next) {
+        size_t total = 0;
+        while (b) {
+            ArenaBlock *next = b->next;
+            total += b->size;
+            free(b);
+            b = next;
+        }
+        a->head = malloc(ARENA_HEADER + total);
+        if (!a->head) return;
+        a->head->next = NULL;
+        a->head->size = total;
+        b = a->head;
+    }
+    b->used = 0;
+}
+
+void arena_free(Arena *a) {
+    while (a->head) {
+        ArenaBlock *next = a->head->next;
+        free(a->head);
+        a->head = next;
+    }
+}
+
+// Each thread gets its own arena, created on first use and freed when the thread exits.
+// Registered functions must not call back into the evaluator, as that would reset it.
+static pthread_key_t arena_key;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+
+static void arena_destroy(void *p) {
+    arena_free(p);
+    free(p);
+}
+
+static void arena_key_init(void) {
+    pthread_key_create(&arena_key, arena_destroy);
+}
+
+Arena *thread_arena(void) {
+    pthread_once(&arena_once, arena_key_init);
+    Arena *a = pthread_getspecific(arena_key);
+    if (!a) {
+        a = calloc(1, sizeof(Arena));
+        if (a && pthread_setspecific(arena_key, a) != 0) { free(a); a = NULL; }
+    }
+    return a;
+}
+
+// Helpers
+int precedence(char op) {
+    switch (op) {
+        case '+': case '-': return 1;
+        case '*': case '/': case '%': return 2;
+        case '^': return 3;
+        default: return 0;
+    }
+}
+int is_right_associative(char op) {
+    return op == '^';
+}
+
+// Function table
+
+// ID of a function name, or -1 if there is no such function
+int find_function(const char *name) {
+    for (int i = 0; i < function_count; i++) {
+        if (strcmp(functions[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Add a function (or replace one with the same name) and return its ID.
+// Functions must be pure, as compile_expression folds calls with constant arguments.
+// Names are letters and '_' only, as that is what tokenize reads; arity is 1..MAX_ARGS.
+// A replacement keeps the arity: compiled programs sized their stacks for it.
+// Returns -1 if the name or arity is invalid, the arity differs or the table is full.
+int register_function(const char *name, int arity, CalcFunction fn) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= MAX_NAME || arity < 1 || arity > MAX_ARGS || !fn) return -1;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalpha((unsigned char)name[i]) && name[i] != '_') return -1;
+    }
+    if (strcmp(name, "Ans") == 0) return -1;
+
+    int id = find_function(name);
+    if (id < 0) {
+        if (function_count == MAX_FUNCTIONS) return -1;
+        id = function_count++;
+        strcpy(functions[id].name, name);
+    } else if (functions[id].arity != arity) {
+        return -1;
+    }
+    functions[id].arity = arity;
+    functions[id].fn = fn;
+    return id;
+}
+double apply_operator(char op, double a, double b, int *error) {
+    switch (op) {
+        case '+': return a + b;
+        case '-': return a - b;
+        case '*': return a * b;
+        case '/': if (b == 0) { *error = 1; return 0; } return a / b;
+        case '%': if ((int)b == 0) { *error = 1; return 0; } return (int)a % (int)b;
+        case '^': return power(a, b);
+        default: *error = 1; return 0;
+    }
+}
+double apply_function(int id, const double args[], int *error) {
+    if (id < 0 || id >= function_count) { *error = 1; return 0; }
+    return functions[id].fn(args, error);
+}
+double fn_sqrt(const double args[], int *error) { return args[0] < 0 ? (*error = 1, 0) : sqrt(args[0]); }
+double fn_abs(const double args[], int *error) { (void)error; return fabs(args[0]); }
+double fn_ln(const double args[], int *error) { return args[0] <= 0 ? (*error = 1, 0) : log(args[0]); }
+double fn_log(const double args[], int *error) { return args[0] <= 0 ? (*error = 1, 0) : log10(args[0]); }
+double fn_exp(const double args[], int *error) { (void)error; return exp(args[0]); }
+double fn_fact(const double args[], int *error) {
+    double a = args[0];
+    if (a < 0 || floor(a) != a) { *error = 1; return 0; }
+    return a > MAX_FACTORIAL ? HUGE_VAL : factorial((int)a);
+}
+double fn_sin(const double args[], int *error) { (void)error; return sin(degrees_to_radians(args[0])); }
+double fn_cos(const double args[], int *error) { (void)error; return cos(degrees_to_radians(args[0])); }
+double fn_tan(const double args[], int *error) { (void)error; return tan(degrees_to_radians(args[0])); }
+double fn_min(const double args[], int *error) { (void)error; return args[0] < args[1] ? args[0] : args[1]; }
+double fn_max(const double args[], int *error) { (void)error; return args[0] > args[1] ? args[0] : args[1]; }
+double fn_clamp(const double args[], int *error) {
+    if (args[1] > args[2]) { *error = 1; return 0; }  // empty range
+    return args[0] < args[1] ? args[1] : (args[0] > args[2] ? args[2] : args[0]);
+}
+double fn_hypot(const double args[], int *error) { (void)error; return hypot(args[0], args[1]); }
+
+// 0! .. 170! are computed once (in the same order as the old loop, so the values
+// are identical) and then looked up; anything larger overflows to infinity
+static double factorial_table[MAX_FACTORIAL + 1];
+static pthread_once_t factorial_once = PTHREAD_ONCE_INIT;
+
+static void factorial_init(void) {
+    factorial_table[0] = 1;
+    for (int i = 1; i <= MAX_FACTORIAL; i++) factorial_table[i] = factorial_table[i - 1] * i;
+}
+
+double factorial(int n) {
+    if (n < 0) return 0;
+    if (n > MAX_FACTORIAL) return HUGE_VAL;
+    pthread_once(&factorial_once, factorial_init);
+    return factorial_table[n];
+}
+
+// a^n (a a whole number, n >= 0) by repeated squaring: about log2(n) multiplications
+// instead of a pow call. Every partial product is a whole number no bigger than the
+// result, so while they stay below 2^53 each multiplication is exact and the result
+// is the exact power, the same double pow returns. Larger powers are left to pow.
+double int_pow(double a, int n) {
+    unsigned int e = (unsigned int)n;
+    double base = a, result = 1;
+    while (e) {
+        if (e & 1) {
+            result *= base;
+            if (fabs(result) >= EXACT_INT_LIMIT) return pow(a, n);
+        }
+        e >>= 1;
+        if (e) {
+            base *= base;
+            if (fabs(base) >= EXACT_INT_LIMIT) return pow(a, n);
+        }
+    }
+    return result;
+}
+
+// The '^' operator. Only shortcuts with a correctly rounded result are taken: x^2 is
+// the single rounding of x*x, exactly what the x DUP * rewrite of optimize_postfix
+// computes, and whole-number bases with small exponents get the exact power from int_pow.
+double power(double a, double b) {
+    if (b == 2) return a * a;
+    if (b > 0 && b <= MAX_INT_EXPONENT && b == (int)b && a == trunc(a) && fabs(a) < EXACT_INT_LIMIT)
+        return int_pow(a, (int)b);
+    return pow(a, b);
+}
+double degrees_to_radians(double deg) {
+    return deg * DEG_TO_RAD;
+}
+// x^0.5 without calling pow; negative inputs and -0 go through pow so the result matches it exactly
+double half_pow(double a) {
+    return a < 0 ? pow(a, 0.5) : sqrt(a + 0.0);
+}
+
+// Streaming mode
+
+/*
+
+In stream mode there are no prompts: stdin is read in STREAM_BLOCK chunks and
+split into lines, each line is evaluated as one expression, and the results are
+formatted into an output buffer that is written out only when it fills up.
+Lines can be any length. Every input line produces exactly one output line
+("Error" for lines that fail) so results stay aligned with the input, and each
+failure is also reported on stderr with its line number. Ans is the result of
+the last line that succeeded.
+
+With --threads N the input is read in blocks of N * PARALLEL_CHUNK bytes, each
+block is cut into N line-aligned chunks, and N worker threads evaluate the chunks
+at the same time into their own output buffers. The buffers are then written in
+input order, so the output is identical to the single-threaded one. Lines that
+use Ans depend on the line before them, so a block that contains "Ans" anywhere
+is evaluated sequentially instead.
+
+*/
+
+// Output buffer: flushed to fp when full, or grown in memory when fp is NULL
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t len;
+    size_t cap;
+} OutBuffer;
+
+static void out_flush(OutBuffer *ob) {
+    if (ob->fp && ob->len) fwrite(ob->buf, 1, ob->len, ob->fp);
+    ob->len = 0;
+}
+
+static int out_write(OutBuffer *ob, const char *s, size_t n) {
+    if (n == 0) return 0;  // s may be the NULL buffer of a chunk without lines
+    if (ob->len + n > ob->cap) {
+        if (ob->fp) {
+            out_flush(ob);
+            if (n > ob->cap) { fwrite(s, 1, n, ob->fp); return 0; }
+        } else {
+            size_t cap = (ob->len + n) * 2;
+            char *buf = realloc(ob->buf, cap);
+            if (!buf) return -1;
+            ob->buf = buf;
+            ob->cap = cap;
+        }
+    }
+    memcpy(ob->buf + ob->len, s, n);
+    ob->len += n;
+    return 0;
+}
+
+// Accept printf formats with exactly one floating-point conversion (e.g. %.6f, %.17g, %12.3e)
+int valid_format(const char *fmt) {
+    int conversions = 0;
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') continue;
+        p++;
+        if (*p == '%') continue;
+        while (*p && strchr("-+ #0", *p)) p++;
+        while (isdigit((unsigned char)*p)) p++;
+        if (*p == '.') { p++; while (isdigit((unsigned char)*p)) p++; }
+        if (*p == 'l') p++;
+        if (!*p || !strchr("fFeEgGaA", *p)) return 0;
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+// Evaluate one line (not including its '\n') and append its result; returns 1 if it failed
+static int stream_line(char *line, size_t len, double *last_result, const char *format,
+                       OutBuffer *ob) {
+    char text[64];
+    int error = 0;
+
+    if (len > 0 && line[len - 1] == '\r') len--;  // CRLF input
+    line[len] = '\0';
+
+    double result = evaluate_expression(line, *last_result, &error);
+    if (error) {
+        out_write(ob, "Error\n", 6);
+        return 1;
+    }
+
+    *last_result = result;
+    int n = snprintf(text, sizeof(text), format, result);
+    if (n < 0) n = 0;
+
+    // Long results (fact(170) or 1e300 under %.6f) are formatted again into a buffer of their size
+    char *big = NULL;
+    char *s = text;
+    if ((size_t)n + 1 >= sizeof(text)) {
+        big = malloc((size_t)n + 2);
+        if (!big) {
+            out_write(ob, "Error\n", 6);
+            return 1;
+        }
+        snprintf(big, (size_t)n + 1, format, result);
+        s = big;
+    }
+    s[n++] = '\n';
+    out_write(ob, s, n);
+    free(big);
+    return 0;
+}
+
+static void report_line_error(long line_no) {
+    fprintf(stderr, "line %ld: Error: Invalid expression\n", line_no);
+}
+
+// Returns the number of lines that failed, STREAM_NO_MEMORY if the buffers cannot be
+// allocated or STREAM_READ_ERROR if the input could not be read
+int run_stream(FILE *in, FILE *out, const char *format) {
+    OutBuffer ob = { out, malloc(STREAM_BLOCK), 0, STREAM_BLOCK };
+    char *block = malloc(STREAM_BLOCK);
+    char *pending = NULL;          // start of a line that continues into the next block
+    size_t pending_len = 0, pending_cap = 0;
+    double last_result = 0.0;
+    long line_no = 0, failed = 0;
+    size_t got;
+
+    if (!ob.buf || !block) { free(ob.buf); free(block); return -1; }
+
+    while ((got = fread(block, 1, STREAM_BLOCK, in)) > 0) {
+        char *p = block, *end = block + got;
+        char *nl;
+
+        while ((nl = memchr(p, '\n', end - p)) != NULL) {
+            int bad;
+            line_no++;
+            if (pending_len) {
+                // finish the line carried over from the previous block
+                size_t n = nl - p;
+                if (pending_len + n + 1 > pending_cap) {
+                    pending_cap = (pending_len + n + 1) * 2;
+                    pending = realloc(pending, pending_cap);
+                    if (!pending) { free(ob.buf); free(block); return -1; }
+                }
+                memcpy(pending + pending_len, p, n);
+                bad = stream_line(pending, pending_len + n, &last_result, format, &ob);
+                pending_len = 0;
+            } else {
+                bad = stream_line(p, nl - p, &last_result, format, &ob);
+            }
+            if (bad) { report_line_error(line_no); failed++; }
+            p = nl + 1;
+        }
+
+        // keep the unfinished tail for the next block
+        size_t n = end - p;
+        if (n) {
+            if (pending_len + n + 1 > pending_cap) {
+                pending_cap = (pending_len + n + 1) * 2;
+                pending = realloc(pending, pending_cap);
+                if (!pending) { free(ob.buf); free(block); return -1; }
+            }
+            memcpy(pending + pending_len, p, n);
+            pending_len += n;
+        }
+    }
+
+    // The lines before a read error have been answered; the rest of the input is lost
+    if (ferror(in)) {
+        out_flush(&ob);
+        fflush(out);
+        free(pending);
+        free(block);
+        free(ob.buf);
+        return STREAM_READ_ERROR;
+    }
+
+    if (pending_len) {
+        line_no++;
+        if (stream_line(pending, pending_len, &last_result, format, &ob)) {
+            report_line_error(line_no);
+            failed++;
+        }
+    }
+
+    out_flush(&ob);
+    fflush(out);
+    free(pending);
+    free(block);
+    free(ob.buf);
+    return (int)failed;
+}
+
+// Parallel streaming
+
+// One worker's share of a block: whole lines in [start, end), the last ends with '\n'
+typedef struct {
+    char *start, *end;
+    const char *format;
+    OutBuffer out;         // in-memory results for this chunk
+    long *bad_lines;       // 0-based line numbers (within the chunk) that failed
+    size_t bad_count, bad_cap;
+    long lines;
+    int has_result;        // a line succeeded, last_result is valid
+    double last_result;
+    int oom;
+} StreamChunk;
+
+static void *stream_worker(void *arg) {
+    StreamChunk *c = arg;
+    double last_result = 0.0;  // only used by Ans, and chunks never contain Ans
+    char *p = c->start;
+
+    c->out.len = 0;
+    c->bad_count = 0;
+    c->lines = 0;
+    c->has_result = 0;
+
+    while (p < c->end) {
+        char *nl = memchr(p, '\n', c->end - p);
+        if (stream_line(p, nl - p, &last_result, c->format, &c->out)) {
+            if (c->bad_count == c->bad_cap) {
+                size_t cap = c->bad_cap ? c->bad_cap * 2 : 64;
+                long *bad = realloc(c->bad_lines, cap * sizeof(long));
+                if (!bad) { c->oom = 1; return NULL; }
+                c->bad_lines = bad;
+                c->bad_cap = cap;
+            }
+            c->bad_lines[c->bad_count++] = c->lines;
+        } else {
+            c->has_result = 1;
+            c->last_result = last_result;
+        }
+        c->lines++;
+        p = nl + 1;
+    }
+    return NULL;
+}
+
+static int contains_ans(const char *p, const char *end) {
+    while ((p = memchr(p, 'A', end - p)) != NULL) {
+        if (end - p >= 3 && p[1] == 'n' && p[2] == 's') return 1;
+        p++;
+    }
+    return 0;
+}
+
+// Evaluate the complete lines in [data, end) and write their results in order
+static int stream_region(char *data, char *end, StreamChunk chunks[], int threads,
+                         OutBuffer *ob, long *line_no, double *last_result, long *failed) {
+    if (contains_ans(data, end)) {
+        // Ans chains every line to the previous one: no parallelism for this block
+        char *p = data;
+        while (p < end) {
+            char *nl = memchr(p, '\n', end - p);
+            (*line_no)++;
+            if (stream_line(p, nl - p, last_result, chunks[0].format, ob)) {
+                report_line_error(*line_no);
+                (*failed)++;
+            }
+            p = nl + 1;
+        }
+        return 0;
+    }
+
+    // cut into line-aligned chunks of roughly equal size
+    pthread_t tids[MAX_THREADS];
+    size_t len = end - data;
+    char *p = data;
+    for (int t = 0; t < threads; t++) {
+        char *cut = (t == threads - 1) ? end : data + len * (t + 1) / threads;
+        if (cut < p) cut = p;
+        if (cut < end && cut > data && cut[-1] != '\n') {
+            char *nl = memchr(cut, '\n', end - cut);
+            cut = nl ? nl + 1 : end;
+        }
+        chunks[t].start = p;
+        chunks[t].end = cut;
+        p = cut;
+    }
+
+    int started[MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        started[t] = pthread_create(&tids[t], NULL, stream_worker, &chunks[t]) == 0;
+        if (!started[t]) stream_worker(&chunks[t]);  // could not start a thread: do it here
+    }
+    for (int t = 0; t < threads; t++) {
+        if (started[t]) pthread_join(tids[t], NULL);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        StreamChunk *c = &chunks[t];
+        if (c->oom) return -1;
+        out_write(ob, c->out.buf, c->out.len);
+        for (size_t i = 0; i < c->bad_count; i++) report_line_error(*line_no + c->bad_lines[i] + 1);
+        *line_no += c->lines;
+        *failed += c->bad_count;
+        if (c->has_result) *last_result = c->last_result;
+    }
+    return 0;
+}
+
+// Multi-threaded version of run_stream; same output, same return value
+int run_stream_parallel(FILE *in, FILE *out, const char *format, int threads) {
+    StreamChunk chunks[MAX_THREADS];
+    OutBuffer ob = { out, malloc(STREAM_BLOCK), 0, STREAM_BLOCK };
+    size_t cap = (size_t)threads * PARALLEL_CHUNK;
+    char *block = malloc(cap + 1);  // +1 for a '\n' after a last line that has none
+    size_t len = 0;
+    double last_result = 0.0;
+    long line_no = 0, failed = 0;
+    int status = 0;
+
+    memset(chunks, 0, sizeof(chunks));
+    for (int t = 0; t < threads; t++) chunks[t].format = format;
+    if (!ob.buf || !block) { free(ob.buf); free(block); return -1; }
+
+    while (status == 0) {
+        size_t got = fread(block + len, 1, cap - len, in);
+        if (ferror(in)) { status = STREAM_READ_ERROR; break; }  // no more data will come
+        len += got;
+        if (len == 0) break;
+
+        int eof = (got == 0 || len < cap) && feof(in);
+        char *data_end = block + len;
+        char *last_nl = NULL;
+        for (char *q = data_end; q > block; q--) {
+            if (q[-1] == '\n') { last_nl = q; break; }
+        }
+
+        if (!last_nl) {
+            if (eof) {
+                block[len++] = '\n';
+                last_nl = block + len;
+            } else if (len == cap) {
+                // a single line longer than the whole block: grow it
+                char *bigger = realloc(block, cap * 2 + 1);
+                if (!bigger) { status = -1; break; }
+                block = bigger;
+                cap *= 2;
+                continue;
+            } else {
+                continue;
+            }
+        }
+
+        status = stream_region(block, last_nl, chunks, threads, &ob, &line_no, &last_result, &failed);
+
+        // move the unfinished tail to the front of the block
+        len = data_end - last_nl > 0 ? (size_t)(data_end - last_nl) : 0;
+        memmove(block, last_nl, len);
+        if (eof && len == 0) break;
+    }
+
+    out_flush(&ob);
+    fflush(out);
+    for (int t = 0; t < threads; t++) {
+        free(chunks[t].out.buf);
+        free(chunks[t].bad_lines);
+    }
+    free(block);
+    free(ob.buf);
+    return status < 0 ? status : (int)failed;
+}
+
+// Everything below is the command-line program; calculator_bench.c defines
+// CALCULATOR_NO_MAIN to reuse the evaluator without it.
+#ifndef CALCULATOR_NO_MAIN
+
+// Read a whole line of any length (without the newline) into a growable buffer.
+// Returns its length, or -1 at end of input.
+static long read_line(char **buf, size_t *cap, FILE *fp) {
+    size_t len = 0;
+    if (!*buf) {
+        *cap = 256;
+        *buf = malloc(*cap);
+        if (!*buf) return -1;
+    }
+    while (fgets(*buf + len, (int)(*cap - len), fp)) {
+        len += strlen(*buf + len);
+        if (len > 0 && (*buf)[len - 1] == '\n') {
+            (*buf)[--len] = '\0';
+            return (long)len;
+        }
+        if (len + 1 < *cap) break;  // last line without a newline
+        char *bigger = realloc(*buf, *cap * 2);
+        if (!bigger) break;
+        *buf = bigger;
+        *cap *= 2;
+    }
+    return len > 0 ? (long)len : -1;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s                      interactive calculator\n", prog);
+    fprintf(stderr, "       %s --stream [--format FMT] [--threads N]\n", prog);
+    fprintf(stderr, "                                 evaluate stdin, one expression per line\n");
+    fprintf(stderr, "FMT is a printf format with one floating-point conversion (default %s)\n", DEFAULT_FORMAT);
+}
+
+// Main program
+int main(int argc, char *argv[]) {
+    int stream = 0, threads = 1;
+    const char *format = DEFAULT_FORMAT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            if (threads < 1 || threads > MAX_THREADS) {
+                fprintf(stderr, "--threads must be between 1 and %d\n", MAX_THREADS);
+                return 2;
+            }
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!valid_format(format)) {
+        fprintf(stderr, "Invalid output format: %s\n", format);
+        return 2;
+    }
+    if (stream) {
+        int failed = threads > 1 ? run_stream_parallel(stdin, stdout, format, threads)
+                                 : run_stream(stdin, stdout, format);
+        if (failed == STREAM_READ_ERROR) {
+            fprintf(stderr, "Error: could not read the input\n");
+            return 2;
+        }
+        if (failed < 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 2;
+        }
+        return failed ? 1 : 0;
+    }
+
+    char *input = NULL;
+    size_t input_cap = 0;
+    double result = 0.0, last_result = 0.0;
+    int error;
+
+    printf("=== Terminal Calculator ===\n");
+    printf("Supports full expressions (e.g., (3 + 2) * 5 - 1 / 2)\n");
+    printf("Unary functions: sqrt, log, sin, fact, etc. | Use 'Ans' for last result\n");
+    printf("Multi-argument functions: min(a, b), max(a, b), clamp(x, lo, hi), hypot(a, b)\n");
+    printf("Type 'q' to quit, 'c' to clear screen.\n");
+
+    while (1) {
+        printf("\nEnter expression: ");
+        if (read_line(&input, &input_cap, stdin) < 0) {
+            printf("\nGoodbye!\n");  // end of input
+            break;
+        }
+
+        if (strcmp(input, "q") == 0 || strcmp(input, "Q") == 0) {
+            printf("Goodbye!\n");
+            break;
+        }
+        if (strcmp(input, "c") == 0 || strcmp(input, "C") == 0) {
+            system("cls"); // Windows clear
+            continue;
+        }
+
+        error = 0;
+        result = evaluate_expression(input, last_result, &error);
+        if (error)
+            printf("Error: Invalid expression\n");
+        else {
+            printf("Result: %.6lf\n", result);
+            last_result = result;
+        }
+    }
+
+    free(input);
+    return 0;
+}
+
+#endif // CALCULATOR_NO_MAIN
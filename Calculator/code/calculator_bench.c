@@ -0,0 +1,421 @@
+/*
+=========================================
+   Calculator Micro-Benchmarks - C
+=========================================
+
+Times each stage of the calculator's hot path over a fixed corpus:
+- tokenize, to_postfix, eval_postfix and evaluate_expression (end to end)
+  for short arithmetic, deep parentheses, function-heavy and long
+  generated expressions
+- apply_function for every built-in function
+- evaluate_compiled and evaluate_batch for formulas with variables,
+  to compare against evaluate_expression on the same shapes
+
+For every measurement it reports ns per expression (or per call / per row),
+throughput, and heap allocations per expression. Allocations are counted by
+wrapping malloc/calloc/realloc around the included Calculator.c.
+
+Usage:
+-----------------------------------
+gcc -O2 -o calculator_bench calculator_bench.c -lm -pthread
+./calculator_bench                 table for humans
+./calculator_bench --json          one JSON object per line, for tracking regressions
+./calculator_bench --time 0.5      seconds per measurement (default 0.2)
+-----------------------------------
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Allocation counting: these wrappers are swapped in for the calculator's own calls
+static unsigned long long bench_allocs = 0;
+
+static void *bench_malloc(size_t n) { bench_allocs++; return malloc(n); }
+static void *bench_calloc(size_t n, size_t m) { bench_allocs++; return calloc(n, m); }
+static void *bench_realloc(void *p, size_t n) { bench_allocs++; return realloc(p, n); }
+
+#define malloc(n) bench_malloc(n)
+#define calloc(n, m) bench_calloc(n, m)
+#define realloc(p, n) bench_realloc(p, n)
+#define CALCULATOR_NO_MAIN
+#include "Calculator.c"
+#undef malloc
+#undef calloc
+#undef realloc
+
+#define MAX_CORPUS 32
+#define BATCH_ROWS 4096
+
+// Keeps the optimizer from dropping the work being timed
+static volatile double sink;
+
+static double now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+// Corpus
+
+typedef struct {
+    const char *name;
+    char *exprs[MAX_CORPUS];
+    int count;
+} Corpus;
+
+static void corpus_add(Corpus *c, const char *expr) {
+    c->exprs[c->count] = malloc(strlen(expr) + 1);
+    strcpy(c->exprs[c->count], expr);
+    c->count++;
+}
+
+static const char *short_exprs[] = {
+    "1+2", "3*4-5", "(3 + 4) * 2 - 1", "10/4", "2^8", "7 % 3", "1.5*2.5+0.25", "100-99*0.5"
+};
+
+static const char *function_exprs[] = {
+    "sqrt(16)+abs(3-7)*ln(10)", "sin(30)+cos(60)+tan(45)", "max(1, min(3, 2)) + hypot(3, 4)",
+    "fact(10)/exp(2)+log(1000)", "clamp(sqrt(50), 1, 5)", "exp(ln(2)*3) - sqrt(abs(1-10))"
+};
+
+// Formulas with variables for the compiled and batch stages
+static const char *formula_exprs[] = {
+    "x*x + 3*y - sqrt(x)", "(x - y)^2 / (1 + x^2)", "max(x, y) * 0.5 + min(x, y) * 0.25",
+    "hypot(x, y) * (180/3) - sqrt(2)*x", "clamp(x / (y + 10), 0, 1)"
+};
+
+// Nested parentheses: ((((1+1)*2)-3)/4 ... depth levels deep
+static void make_deep(char *buf, int depth) {
+    static const char ops[] = "*-/+";
+    char *p = buf;
+    for (int i = 0; i < depth; i++) *p++ = '(';
+    p += sprintf(p, "1+1)");
+    for (int i = 1; i < depth; i++) p += sprintf(p, "%c%d)", ops[i % 4], i % 9 + 1);
+    *p = '\0';
+}
+
+// Long flat expression with n operands: 1+2*3-4/5+...
+static void make_long(char *buf, int n, unsigned seed) {
+    static const char ops[] = "+-*/";
+    char *p = buf;
+    p += sprintf(p, "%u", seed % 97 + 1);
+    for (int i = 1; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        p += sprintf(p, "%c%u.%u", ops[(seed >> 16) % 4], (seed >> 8) % 97 + 1, seed % 10);
+    }
+    *p = '\0';
+}
+
+static void build_corpora(Corpus corpora[4]) {
+    static char buf[64 * 1024];
+
+    corpora[0].name = "short";
+    for (size_t i = 0; i < sizeof(short_exprs) / sizeof(short_exprs[0]); i++)
+        corpus_add(&corpora[0], short_exprs[i]);
+
+    corpora[1].name = "deep_parens";
+    for (int depth = 10; depth <= 60; depth += 10) {
+        make_deep(buf, depth);
+        corpus_add(&corpora[1], buf);
+    }
+
+    corpora[2].name = "functions";
+    for (size_t i = 0; i < sizeof(function_exprs) / sizeof(function_exprs[0]); i++)
+        corpus_add(&corpora[2], function_exprs[i]);
+
+    corpora[3].name = "long_generated";
+    for (unsigned i = 0; i < 4; i++) {
+        make_long(buf, 500 + 500 * i, 7 + i);
+        corpus_add(&corpora[3], buf);
+    }
+}
+
+// Reporting
+
+static int json_output = 0;
+
+static void report(const char *stage, const char *corpus, double ns, double items,
+                   unsigned long long allocs) {
+    double ns_per = ns / items;
+    double per_sec = items / (ns / 1e9);
+    double allocs_per = allocs / items;
+
+    if (json_output) {
+        printf("{\"stage\":\"%s\",\"corpus\":\"%s\",\"items\":%.0f,\"ns_per_item\":%.2f,"
+               "\"items_per_sec\":%.0f,\"allocs_per_item\":%.4f}\n",
+               stage, corpus, items, ns_per, per_sec, allocs_per);
+    } else {
+        printf("%-20s %-16s %12.1f %14.0f %12.4f\n", stage, corpus, ns_per, per_sec, allocs_per);
+    }
+}
+
+// Runs body() rounds times, doubling rounds until the run takes at least min_ns
+typedef void (*BenchBody)(void *ctx, long rounds);
+
+static double min_ns = 0.2e9;
+
+static void measure(const char *stage, const char *corpus, BenchBody body, void *ctx,
+                    double items_per_round) {
+    body(ctx, 1);  // warm-up: lets the arena grow to its steady-state size
+
+    long rounds = 1;
+    double elapsed;
+    unsigned long long allocs;
+    for (;;) {
+        unsigned long long before = bench_allocs;
+        double start = now_ns();
+        body(ctx, rounds);
+        elapsed = now_ns() - start;
+        allocs = bench_allocs - before;
+        if (elapsed >= min_ns || rounds > (1L << 40)) break;
+        rounds *= 2;
+    }
+    report(stage, corpus, elapsed, items_per_round * rounds, allocs);
+}
+
+// Stage bodies
+
+typedef struct {
+    Corpus *corpus;
+    Token *tokens[MAX_CORPUS];   // tokenize output, input to to_postfix
+    int ntokens[MAX_CORPUS];
+    Token *postfix[MAX_CORPUS];  // to_postfix output, input to eval_postfix
+    int npost[MAX_CORPUS];
+    double *stack[MAX_CORPUS];
+    Arena arena;
+} StageCtx;
+
+static void body_tokenize(void *p, long rounds) {
+    StageCtx *c = p;
+    long total = 0;
+    for (long r = 0; r < rounds; r++)
+        for (int i = 0; i < c->corpus->count; i++)
+            total += tokenize(c->corpus->exprs[i], c->tokens[i], 0.0, NULL);
+    sink = (double)total;
+}
+
+static void body_to_postfix(void *p, long rounds) {
+    StageCtx *c = p;
+    long total = 0;
+    for (long r = 0; r < rounds; r++)
+        for (int i = 0; i < c->corpus->count; i++) {
+            arena_reset(&c->arena);
+            total += to_postfix(c->tokens[i], c->ntokens[i], c->postfix[i], &c->arena);
+        }
+    sink = (double)total;
+}
+
+static void body_eval_postfix(void *p, long rounds) {
+    StageCtx *c = p;
+    double total = 0;
+    for (long r = 0; r < rounds; r++)
+        for (int i = 0; i < c->corpus->count; i++) {
+            int error = 0;
+            total += eval_postfix(c->postfix[i], c->npost[i], NULL, c->stack[i], &error);
+        }
+    sink = total;
+}
+
+static void body_evaluate_expression(void *p, long rounds) {
+    StageCtx *c = p;
+    double total = 0;
+    for (long r = 0; r < rounds; r++)
+        for (int i = 0; i < c->corpus->count; i++) {
+            int error = 0;
+            total += evaluate_expression(c->corpus->exprs[i], 0.0, &error);
+        }
+    sink = total;
+}
+
+static void bench_corpus(Corpus *corpus) {
+    StageCtx c;
+    memset(&c, 0, sizeof(c));
+    c.corpus = corpus;
+
+    for (int i = 0; i < corpus->count; i++) {
+        size_t len = strlen(corpus->exprs[i]) + 1;
+        c.tokens[i] = malloc(len * sizeof(Token));
+        c.postfix[i] = malloc(len * sizeof(Token));
+        c.stack[i] = malloc(len * sizeof(double));
+        c.ntokens[i] = tokenize(corpus->exprs[i], c.tokens[i], 0.0, NULL);
+        arena_reset(&c.arena);
+        c.npost[i] = to_postfix(c.tokens[i], c.ntokens[i], c.postfix[i], &c.arena);
+        if (c.ntokens[i] < 0 || c.npost[i] < 0) {
+            fprintf(stderr, "bench: corpus %s has an invalid expression: %s\n", corpus->name, corpus->exprs[i]);
+            exit(1);
+        }
+    }
+
+    measure("tokenize", corpus->name, body_tokenize, &c, corpus->count);
+    measure("to_postfix", corpus->name, body_to_postfix, &c, corpus->count);
+    measure("eval_postfix", corpus->name, body_eval_postfix, &c, corpus->count);
+    measure("evaluate_expression", corpus->name, body_evaluate_expression, &c, corpus->count);
+
+    for (int i = 0; i < corpus->count; i++) {
+        free(c.tokens[i]);
+        free(c.postfix[i]);
+        free(c.stack[i]);
+    }
+    arena_free(&c.arena);
+}
+
+// apply_function, one built-in at a time
+
+typedef struct {
+    int id;
+    double args[MAX_ARGS];
+} FunctionCtx;
+
+static void body_apply_function(void *p, long rounds) {
+    FunctionCtx *c = p;
+    double total = 0;
+    double args[MAX_ARGS];
+    memcpy(args, c->args, sizeof(args));
+    for (long r = 0; r < rounds; r++) {
+        int error = 0;
+        args[0] = c->args[0] + (r & 7);  // vary the input a little
+        total += apply_function(c->id, args, &error);
+    }
+    sink = total;
+}
+
+static void bench_functions(void) {
+    for (int id = 0; id < function_count; id++) {
+        FunctionCtx c = { id, { 3.0, 1.0, 10.0, 0.0 } };
+        measure("apply_function", functions[id].name, body_apply_function, &c, 1);
+    }
+}
+
+// Compiled and batch evaluation of formulas with variables
+
+typedef struct {
+    const char *expr;
+    CompiledExpr ce;
+    double *columns[MAX_VARS];
+    double *out;
+    int *errors;
+} FormulaCtx;
+
+// Baseline: the same shape with the variables written in as numbers, parsed from text every time
+static void body_formula_expression(void *p, long rounds) {
+    FormulaCtx *c = p;
+    double total = 0;
+    for (long r = 0; r < rounds; r++) {
+        int error = 0;
+        total += evaluate_expression(c->expr, 0.0, &error);
+    }
+    sink = total;
+}
+
+static void body_formula_compiled(void *p, long rounds) {
+    FormulaCtx *c = p;
+    double total = 0, vars[MAX_VARS];
+    for (long r = 0; r < rounds; r++) {
+        int row = (int)(r % BATCH_ROWS), error = 0;
+        for (int v = 0; v < c->ce.var_count; v++) vars[v] = c->columns[v][row];
+        total += evaluate_compiled(&c->ce, vars, &error);
+    }
+    sink = total;
+}
+
+static void body_formula_batch(void *p, long rounds) {
+    FormulaCtx *c = p;
+    size_t failed = 0;
+    for (long r = 0; r < rounds; r++)
+        failed += evaluate_batch(&c->ce, (const double *const *)c->columns, BATCH_ROWS, c->out, c->errors);
+    sink = (double)failed + c->out[0];
+}
+
+// Replace every variable of expr with a numeric literal, for the evaluate_expression baseline
+static void substitute_variables(const char *expr, char *out) {
+    while (*expr) {
+        if (isalpha((unsigned char)*expr) || *expr == '_') {
+            char name[MAX_NAME];
+            int i = 0;
+            while ((isalpha((unsigned char)*expr) || *expr == '_') && i < MAX_NAME - 1) name[i++] = *expr++;
+            name[i] = '\0';
+            out += sprintf(out, "%s", find_function(name) >= 0 ? name : "1.25");
+        } else {
+            *out++ = *expr++;
+        }
+    }
+    *out = '\0';
+}
+
+static void bench_formulas(void) {
+    for (size_t f = 0; f < sizeof(formula_exprs) / sizeof(formula_exprs[0]); f++) {
+        FormulaCtx c;
+        char label[16], literal[256];
+        memset(&c, 0, sizeof(c));
+        if (compile_expression(formula_exprs[f], &c.ce) != 0) {
+            fprintf(stderr, "bench: formula does not compile: %s\n", formula_exprs[f]);
+            exit(1);
+        }
+        for (int v = 0; v < c.ce.var_count; v++) {
+            c.columns[v] = malloc(BATCH_ROWS * sizeof(double));
+            for (int i = 0; i < BATCH_ROWS; i++) c.columns[v][i] = (i % 100) * 0.37 + v;
+        }
+        c.out = malloc(BATCH_ROWS * sizeof(double));
+        c.errors = malloc(BATCH_ROWS * sizeof(int));
+
+        substitute_variables(formula_exprs[f], literal);
+        c.expr = literal;
+        sprintf(label, "formula_%zu", f + 1);
+
+        measure("evaluate_expression", label, body_formula_expression, &c, 1);
+        measure("evaluate_compiled", label, body_formula_compiled, &c, 1);
+        measure("evaluate_batch", label, body_formula_batch, &c, BATCH_ROWS);
+
+        for (int v = 0; v < c.ce.var_count; v++) free(c.columns[v]);
+        free(c.out);
+        free(c.errors);
+        free_compiled(&c.ce);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json_output = 1;
+        } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            min_ns = atof(argv[++i]) * 1e9;
+            if (min_ns <= 0) min_ns = 0.2e9;
+        } else {
+            fprintf(stderr, "Usage: %s [--json] [--time SECONDS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Corpus corpora[4];
+    memset(corpora, 0, sizeof(corpora));
+    build_corpora(corpora);
+
+    if (!json_output) {
+        printf("%-20s %-16s %12s %14s %12s\n", "stage", "corpus", "ns/item", "items/sec", "allocs/item");
+        printf("------------------------------------------------------------------------------\n");
+    }
+
+    for (int i = 0; i < 4; i++) bench_corpus(&corpora[i]);
+    bench_functions();
+    bench_formulas();
+
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < corpora[i].count; j++) free(corpora[i].exprs[j]);
+    return 0;
+}
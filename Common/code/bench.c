@@ -0,0 +1,159 @@
+/*
+==============================================
+   Benchmark helpers - C
+==============================================
+
+Implementation of bench.h (compiled into the benchmarks only; on Windows
+link with -lpsapi for the peak memory).
+
+Author: Vaggelis Papaioannou
+*/
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <direct.h>
+#else
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static int jsonOutput = 0;
+static const char *toolName = "";
+static long datasetRecords = 0;
+
+double benchNow() {
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+void benchInit(BenchTimer *t, const char *name, long expected) {
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->capacity = expected > 0 ? expected : 1024;
+    t->samples = malloc(t->capacity * sizeof(double));
+    if (!t->samples) t->capacity = 0;
+}
+
+void benchAdd(BenchTimer *t, double ns) {
+    if (t->count == t->capacity) {
+        long capacity = t->capacity ? t->capacity * 2 : 1024;
+        double *samples = realloc(t->samples, capacity * sizeof(double));
+        if (!samples) return;  // Out of memory: the sample is dropped
+        t->samples = samples;
+        t->capacity = capacity;
+    }
+    t->samples[t->count++] = ns;
+}
+
+void benchFree(BenchTimer *t) {
+    free(t->samples);
+    memset(t, 0, sizeof(*t));
+}
+
+static int compareSamples(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const BenchTimer *t, double p) {
+    long rank = (long)(p / 100.0 * t->count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > t->count) rank = t->count;
+    return t->samples[rank - 1];
+}
+
+static void printRow(const char *name, long count, double p50, double p90, double p99, double max,
+                     double perSec) {
+    if (jsonOutput) {
+        printf("{\"tool\":\"%s\",\"records\":%ld,\"op\":\"%s\",\"count\":%ld,\"p50_ns\":%.0f,"
+               "\"p90_ns\":%.0f,\"p99_ns\":%.0f,\"max_ns\":%.0f,\"items_per_sec\":%.0f}\n",
+               toolName, datasetRecords, name, count, p50, p90, p99, max, perSec);
+    } else {
+        printf("%-22s %9ld %11.2f %11.2f %11.2f %11.2f %14.0f\n",
+               name, count, p50 / 1e3, p90 / 1e3, p99 / 1e3, max / 1e3, perSec);
+    }
+    fflush(stdout);
+}
+
+void benchReport(BenchTimer *t, double itemsPerSample) {
+    if (t->count == 0) return;
+
+    double total = 0;
+    for (long i = 0; i < t->count; i++) total += t->samples[i];
+    qsort(t->samples, t->count, sizeof(double), compareSamples);
+
+    double perSec = total > 0 ? t->count * itemsPerSample / (total / 1e9) : 0;
+    printRow(t->name, t->count, percentile(t, 50), percentile(t, 90), percentile(t, 99),
+             t->samples[t->count - 1], perSec);
+}
+
+void benchReportOnce(const char *name, double ns, double items) {
+    printRow(name, 1, ns, ns, ns, ns, ns > 0 ? items / (ns / 1e9) : 0);
+}
+
+void benchReportValue(const char *name, double value) {
+    if (jsonOutput)
+        printf("{\"tool\":\"%s\",\"records\":%ld,\"%s\":%.0f}\n", toolName, datasetRecords, name, value);
+    else
+        printf("%-22s %.0f\n", name, value);
+    fflush(stdout);
+}
+
+long benchPeakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return (long)(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    return usage.ru_maxrss;         // KB on Linux and the BSDs
+#endif
+#endif
+}
+
+int benchEnterDir(const char *dir) {
+#ifdef _WIN32
+    _mkdir(dir);  // Fails harmlessly if it exists
+    return _chdir(dir) == 0;
+#else
+    mkdir(dir, 0777);
+    return chdir(dir) == 0;
+#endif
+}
+
+void benchSetJson(int json) {
+    jsonOutput = json;
+}
+
+void benchPrintHeader(const char *tool, long records) {
+    toolName = tool;
+    datasetRecords = records;
+    if (jsonOutput) return;
+
+    printf("%s, %ld records\n", tool, records);
+    printf("%-22s %9s %11s %11s %11s %11s %14s\n", "operation", "count", "p50 us", "p90 us", "p99 us",
+           "max us", "items/sec");
+    printf("------------------------------------------------------------------------------------------------\n");
+}
@@ -0,0 +1,62 @@
+/*
+==============================================
+   Benchmark helpers - C
+==============================================
+
+Timing, latency percentiles and peak memory for the benchmarks of the
+record tools (student_records_bench.c, todolist_bench.c):
+
+  BenchTimer t;
+  benchInit(&t, "search_roll", ops);
+  for (...) {
+      double start = benchNow();
+      ... one operation ...
+      benchAdd(&t, benchNow() - start);
+  }
+  benchReport(&t, 1);   // p50 / p90 / p99 / max latency and operations per second
+  benchFree(&t);
+
+benchSetJson(1) switches the reports to one JSON object per line (the same
+idea as calculator_bench --json), for tracking regressions.
+
+Author: Vaggelis Papaioannou
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+// Latency samples of one operation, in nanoseconds
+typedef struct {
+    const char *name;
+    double *samples;
+    long count;
+    long capacity;
+} BenchTimer;
+
+// Monotonic clock in nanoseconds
+double benchNow();
+
+void benchInit(BenchTimer *t, const char *name, long expected);
+void benchAdd(BenchTimer *t, double ns);
+void benchFree(BenchTimer *t);
+
+// Print one row for t; every sample handled itemsPerSample items (records, rows, ...)
+void benchReport(BenchTimer *t, double itemsPerSample);
+
+// Time a single long step (load, save, export, ...) that handled items items
+void benchReportOnce(const char *name, double ns, double items);
+
+// Print a named number (dataset size, counters, ...)
+void benchReportValue(const char *name, double value);
+
+// Peak resident set size of the process so far, in KB (0 if unknown)
+long benchPeakRssKb();
+
+// Create dir if needed and make it the working directory, so the generated
+// files never replace real ones; returns 1 on success
+int benchEnterDir(const char *dir);
+
+void benchSetJson(int json);
+void benchPrintHeader(const char *tool, long records);
+
+#endif
@@ -0,0 +1,170 @@
+/*
+==============================================
+   Append-only journal - C
+==============================================
+
+Implementation of journal.h. Uses crc32Update from recfile.c, so compile
+both with the program, e.g.:
+
+gcc -o todolist todolist.c ../../Common/code/recfile.c ../../Common/code/journal.c
+
+Author: Vaggelis Papaioannou
+*/
+
+#define _FILE_OFFSET_BITS 64  // 64-bit off_t for ftruncate on 32-bit POSIX systems
+
+#include "journal.h"
+#include "recfile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// CRC of an entry and its payload
+static uint32_t entryCrc(const JournalEntry *e, const void *payload) {
+    JournalEntry copy = *e;
+    copy.crc = 0;
+    return crc32Update(crc32Update(0, &copy, sizeof(copy)), payload, e->length);
+}
+
+// Read the next entry of fp into e and payload; returns 1 if it is intact, 0 at the end
+// of the file or at a torn or damaged entry
+static int readEntry(FILE *fp, JournalEntry *e, unsigned char *payload) {
+    return fread(e, sizeof(*e), 1, fp) == 1 && e->length <= JOURNAL_MAX_PAYLOAD &&
+           fread(payload, 1, e->length, fp) == e->length && e->crc == entryCrc(e, payload);
+}
+
+long journalReplay(const char *path, uint64_t afterSeq, JournalCallback callback, void *ctx,
+                   uint64_t *lastSeq, long *entries) {
+    unsigned char payload[JOURNAL_MAX_PAYLOAD];
+    JournalEntry e;
+    long applied = 0, valid = 0;
+
+    *lastSeq = afterSeq;
+    if (entries) *entries = 0;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    // Stop at the end of the file or at the first entry that is not intact
+    while (readEntry(fp, &e, payload)) {
+        valid++;
+        if (e.seq > *lastSeq) *lastSeq = e.seq;
+        if (e.seq <= afterSeq) continue;  // Already in the data file
+
+        applied++;
+        if (!callback(e.op, e.seq, payload, e.length, ctx)) break;
+    }
+
+    fclose(fp);
+    if (entries) *entries = valid;
+    return applied;
+}
+
+// Cut the file of j off at end and make it durable; returns 1 on success
+static int truncateJournal(Journal *j, long end) {
+    if (fflush(j->fp) != 0) return 0;
+#ifdef _WIN32
+    if (_chsize_s(_fileno(j->fp), end) != 0) return 0;
+#else
+    if (ftruncate(fileno(j->fp), (off_t)end) != 0) return 0;
+#endif
+    return journalSync(j);
+}
+
+int journalOpen(Journal *j, const char *path, uint64_t lastSeq, int syncEvery) {
+    unsigned char payload[JOURNAL_MAX_PAYLOAD];
+    JournalEntry e;
+    long end = 0;
+
+    memset(j, 0, sizeof(*j));
+    snprintf(j->path, sizeof(j->path), "%s", path);
+    j->seq = lastSeq;
+    j->syncEvery = syncEvery;
+
+    j->fp = fopen(path, "r+b");
+    if (!j->fp) j->fp = fopen(path, "w+b");  // No journal yet
+    if (!j->fp) return 0;
+
+    // A torn entry left by a crash is cut off, so new entries follow the last intact one
+    // (appended after it, they would never be replayed). The journal is emptied at every
+    // checkpoint, so its length fits a long.
+    while (readEntry(j->fp, &e, payload)) {
+        end += (long)sizeof(e) + e.length;
+        j->entries++;
+    }
+    int ok = fseek(j->fp, 0, SEEK_END) == 0;
+    long length = ok ? ftell(j->fp) : -1;
+    if (length != end) ok = length > end && truncateJournal(j, end) && fseek(j->fp, 0, SEEK_END) == 0;
+    if (!ok) {
+        fclose(j->fp);
+        j->fp = NULL;
+    }
+    return ok;
+}
+
+int journalSync(Journal *j) {
+    if (!j->fp) return 0;
+    j->pending = 0;
+    if (fflush(j->fp) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(j->fp)) == 0;
+#else
+    return fsync(fileno(j->fp)) == 0;
+#endif
+}
+
+int journalAppend(Journal *j, uint32_t op, const void *payload, uint32_t length) {
+    JournalEntry e;
+
+    if (!j->fp || length > JOURNAL_MAX_PAYLOAD) return 0;
+
+    memset(&e, 0, sizeof(e));
+    e.length = length;
+    e.op = op;
+    e.seq = j->seq + 1;
+    e.crc = entryCrc(&e, payload);
+
+    if (fwrite(&e, sizeof(e), 1, j->fp) != 1) return 0;
+    if (length > 0 && fwrite(payload, 1, length, j->fp) != length) return 0;
+    j->seq++;
+    j->entries++;
+    j->pending++;
+
+    if (j->batch) return 1;
+    if (j->syncEvery > 0 && j->pending >= j->syncEvery) return journalSync(j);
+    return fflush(j->fp) == 0;  // Handed to the OS: survives a crash of the program
+}
+
+void journalBeginBatch(Journal *j) {
+    j->batch = 1;
+}
+
+int journalEndBatch(Journal *j) {
+    j->batch = 0;
+    if (j->fp && j->pending == 0) return 1;  // Nothing written since the last sync
+    if (j->syncEvery > 0) return journalSync(j);
+    return j->fp && fflush(j->fp) == 0;
+}
+
+int journalReset(Journal *j) {
+    if (!j->fp) return 1;
+
+    fclose(j->fp);
+    j->fp = fopen(j->path, "wb");
+    j->pending = 0;
+    j->entries = 0;
+    return j->fp != NULL;
+}
+
+void journalClose(Journal *j) {
+    if (!j->fp) return;
+    if (j->syncEvery > 0) journalSync(j);
+    fclose(j->fp);
+    j->fp = NULL;
+}
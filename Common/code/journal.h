@@ -0,0 +1,88 @@
+/*
+==============================================
+   Append-only journal - C
+==============================================
+
+A write-ahead log of small change records (add, edit, delete, ...) kept
+next to a data file. Every change is appended to the journal before it is
+applied, so a change costs one small append instead of a rewrite, and a
+crash loses nothing that reached the journal.
+
+Entry layout:
+
+  +--------------------------------------+
+  | JournalEntry (24 bytes)              |
+  |   length, op, seq, crc               |
+  +--------------------------------------+
+  | payload (length bytes)               |
+  +--------------------------------------+
+
+- seq increases by one per entry; the data file stores the last seq it
+  contains (RecFileHeader.lastSeq), so replay skips entries that are
+  already in it and replaying twice is harmless
+- crc covers the entry header and payload; a torn entry at the end
+  (crash in the middle of an append) ends the replay, and journalOpen
+  cuts it off before anything is appended
+- A checkpoint writes the data file with the current seq and then
+  empties the journal (journalReset)
+- fsync is optional: syncEvery = N syncs after every N entries (group
+  commit), 0 leaves it to the OS; batches sync once at the end
+
+Author: Vaggelis Papaioannou
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define JOURNAL_MAX_PAYLOAD 4096  // Longer entries can only be garbage
+
+typedef struct {
+    uint32_t length;    // Payload bytes
+    uint32_t op;        // Meaning is up to the program
+    uint64_t seq;
+    uint32_t crc;       // CRC32 of this header (with crc = 0) and the payload
+    uint32_t reserved;  // 0
+} JournalEntry;
+
+typedef struct {
+    FILE *fp;
+    char path[260];
+    uint64_t seq;       // Last sequence number written (or replayed)
+    int syncEvery;
+    int pending;        // Entries since the last sync
+    int batch;          // Inside journalBeginBatch/journalEndBatch
+    long entries;       // Entries in the journal file
+} Journal;
+
+// Called once per replayed entry; return 0 to stop the replay
+typedef int (*JournalCallback)(uint32_t op, uint64_t seq, const void *payload, uint32_t length, void *ctx);
+
+// Replay the entries of path with seq > afterSeq, in order. Returns the number of
+// entries passed to callback; *lastSeq gets the highest valid seq in the file
+// (or afterSeq), *entries (may be NULL) the number of valid entries in it.
+long journalReplay(const char *path, uint64_t afterSeq, JournalCallback callback, void *ctx,
+                   uint64_t *lastSeq, long *entries);
+
+// Open path for appending; new entries are numbered after lastSeq. A torn entry at the
+// end is cut off first, so they follow the last intact one. Returns 1 on success.
+int journalOpen(Journal *j, const char *path, uint64_t lastSeq, int syncEvery);
+
+// Append one entry; returns 1 once it is written (and synced, if it is due)
+int journalAppend(Journal *j, uint32_t op, const void *payload, uint32_t length);
+
+// Group commit: no syncs between these two calls, one sync at the end (none if nothing was written)
+void journalBeginBatch(Journal *j);
+int journalEndBatch(Journal *j);
+
+// Flush and fsync the journal; returns 1 on success
+int journalSync(Journal *j);
+
+// Empty the journal after a checkpoint; returns 1 on success (also when it is not open)
+int journalReset(Journal *j);
+
+void journalClose(Journal *j);
+
+#endif
@@ -0,0 +1,819 @@
+/*
+==============================================
+   Shared record file format - C
+==============================================
+
+Reader, writer and in-place updates for the format described in
+recfile.h. Compile it together with the program that uses it, e.g.:
+
+gcc -o student_records student_records.c ../../Common/code/recfile.c ../../Common/code/journal.c
+
+Author: Vaggelis Papaioannou
+*/
+
+#define _FILE_OFFSET_BITS 64  // 64-bit off_t for fseeko on 32-bit POSIX systems
+
+#include "recfile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+typedef char headerSizeCheck[sizeof(RecFileHeader) == RECFILE_HEADER_SIZE ? 1 : -1];
+
+// ---------- CRC32 (IEEE 802.3, the one used by zip and PNG) ----------
+
+static uint32_t crcTable[256];
+static int crcReady = 0;
+
+static void buildCrcTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crcTable[i] = c;
+    }
+    crcReady = 1;
+}
+
+// Continue a CRC32 over len more bytes (start with crc = 0)
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len) {
+    const unsigned char *p = data;
+
+    if (!crcReady) buildCrcTable();
+
+    crc = ~crc;
+    while (len--) crc = crcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ---------- Memory mapping ----------
+
+const char *mapFile(const char *path, size_t *size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0 || (uint64_t)length.QuadPart > SIZE_MAX) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return NULL;
+
+    // The view keeps the file mapped after both handles are closed
+    const char *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) return NULL;
+
+    *size = (size_t)length.QuadPart;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+void unmapFile(const char *data, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+// ---------- Durability ----------
+
+// Flush fp and fsync it; returns 1 on success
+static int syncStream(FILE *fp) {
+    if (fflush(fp) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(fp)) == 0;
+#else
+    return fsync(fileno(fp)) == 0;
+#endif
+}
+
+// fsync the directory of path, so a file created or renamed there survives a power loss
+static int syncDir(const char *path) {
+#ifdef _WIN32
+    (void)path;  // NTFS journals renames; MoveFileEx is used with MOVEFILE_WRITE_THROUGH
+    return 1;
+#else
+    char dir[280];
+    const char *slash = strrchr(path, '/');
+    if (!slash) strcpy(dir, ".");
+    else snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+// Replace path with tmpPath in one step and make the rename durable
+static int replaceFile(const char *tmpPath, const char *path) {
+#ifdef _WIN32
+    return MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(tmpPath, path) == 0 && syncDir(path);
+#endif
+}
+
+// ---------- Locking ----------
+
+int recFileLockOpen(const char *path, intptr_t *lock) {
+    char name[280];
+
+    snprintf(name, sizeof(name), "%s.lock", path);
+#ifdef _WIN32
+    // Read-only when it cannot be created here: enough for the shared lock of a reader
+    HANDLE file = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    *lock = (intptr_t)file;
+#else
+    int fd = open(name, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) fd = open(name, O_RDONLY);
+    if (fd < 0) return 0;
+    *lock = fd;
+#endif
+    return 1;
+}
+
+int recFileLock(intptr_t lock, int which, int flags) {
+#ifdef _WIN32
+    OVERLAPPED at = {0};
+    DWORD mode = (flags & RECFILE_LOCK_SHARED ? 0 : LOCKFILE_EXCLUSIVE_LOCK) |
+                 (flags & RECFILE_LOCK_WAIT ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+    at.Offset = (DWORD)which;
+    if (LockFileEx((HANDLE)lock, mode, 0, 1, 0, &at)) return 1;
+    return GetLastError() == ERROR_LOCK_VIOLATION ? 0 : -1;
+#else
+    // Byte which of the lock file; the two locks are independent of each other
+    struct flock range;
+    memset(&range, 0, sizeof(range));
+    range.l_type = flags & RECFILE_LOCK_SHARED ? F_RDLCK : F_WRLCK;
+    range.l_whence = SEEK_SET;
+    range.l_start = which;
+    range.l_len = 1;
+    for (;;) {
+        if (fcntl((int)lock, flags & RECFILE_LOCK_WAIT ? F_SETLKW : F_SETLK, &range) == 0) return 1;
+        if (errno == EINTR) continue;
+        return errno == EACCES || errno == EAGAIN ? 0 : -1;
+    }
+#endif
+}
+
+void recFileUnlock(intptr_t lock, int which) {
+#ifdef _WIN32
+    OVERLAPPED at = {0};
+    at.Offset = (DWORD)which;
+    UnlockFileEx((HANDLE)lock, 0, 1, 0, &at);
+#else
+    struct flock range;
+    memset(&range, 0, sizeof(range));
+    range.l_type = F_UNLCK;
+    range.l_whence = SEEK_SET;
+    range.l_start = which;
+    range.l_len = 1;
+    fcntl((int)lock, F_SETLK, &range);
+#endif
+}
+
+void recFileLockClose(intptr_t lock) {
+#ifdef _WIN32
+    CloseHandle((HANDLE)lock);  // Releases its locks
+#else
+    close((int)lock);
+#endif
+}
+
+// ---------- Header and layout ----------
+
+// Files can outgrow a long (32 bits on Windows), so offsets are int64_t
+static int seekFile(FILE *fp, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(fp, offset, SEEK_SET);
+#else
+    return fseeko(fp, (off_t)offset, SEEK_SET);
+#endif
+}
+
+// Length of an open file (its position is left at the end), or -1 on errors
+static int64_t fileLength(FILE *fp) {
+#ifdef _WIN32
+    return _fseeki64(fp, 0, SEEK_END) == 0 ? _ftelli64(fp) : -1;
+#else
+    return fseeko(fp, 0, SEEK_END) == 0 ? (int64_t)ftello(fp) : -1;
+#endif
+}
+
+static void initHeader(RecFileHeader *h, uint32_t recordType, size_t recordSize, uint64_t lastSeq) {
+    memset(h, 0, sizeof(*h));
+    h->magic = RECFILE_MAGIC;
+    h->version = RECFILE_VERSION;
+    h->headerSize = RECFILE_HEADER_SIZE;
+    h->recordSize = (uint32_t)recordSize;
+    h->blockRecords = RECFILE_BLOCK_RECORDS;
+    h->recordType = recordType;
+    h->lastSeq = lastSeq;
+}
+
+// Is the header usable by this version of the format?
+static int headerValid(const RecFileHeader *h) {
+    return h->magic == RECFILE_MAGIC &&
+           h->headerCrc == crc32Update(0, h, offsetof(RecFileHeader, headerCrc)) &&
+           h->version >= 1 && h->version <= RECFILE_VERSION &&
+           h->headerSize >= RECFILE_HEADER_SIZE &&
+           h->recordSize > 0 && h->blockRecords > 0;
+}
+
+// Read and check the header of an open file; returns 1 if it is valid
+static int readHeader(FILE *fp, RecFileHeader *h) {
+    return seekFile(fp, 0) == 0 && fread(h, sizeof(*h), 1, fp) == 1 && headerValid(h);
+}
+
+static int writeHeader(FILE *fp, RecFileHeader *h) {
+    h->headerCrc = crc32Update(0, h, offsetof(RecFileHeader, headerCrc));
+    return seekFile(fp, 0) == 0 && fwrite(h, sizeof(*h), 1, fp) == 1;
+}
+
+// Byte offset of the first record of block number block
+static int64_t blockOffset(const RecFileHeader *h, int64_t block) {
+    return (int64_t)h->headerSize + block * ((int64_t)h->blockRecords * h->recordSize + (int64_t)sizeof(uint32_t));
+}
+
+// Records in block number block
+static long blockLength(const RecFileHeader *h, int64_t block) {
+    int64_t left = (int64_t)h->recordCount - block * (int64_t)h->blockRecords;
+    return left < (int64_t)h->blockRecords ? (long)left : (long)h->blockRecords;
+}
+
+// Read block number block into buf and check its CRC; returns 1 if it is intact
+static int readBlock(FILE *fp, const RecFileHeader *h, int64_t block, unsigned char *buf) {
+    size_t bytes = (size_t)blockLength(h, block) * h->recordSize;
+    uint32_t crc;
+
+    return seekFile(fp, blockOffset(h, block)) == 0 &&
+           fread(buf, 1, bytes, fp) == bytes &&
+           fread(&crc, sizeof(crc), 1, fp) == 1 &&
+           crc == crc32Update(0, buf, bytes);
+}
+
+// ---------- In-place updates ----------
+
+// path.dwb holds the blocks of an update before they are written in place:
+//   uint32 magic, uint32 count, count x (uint64 offset, uint32 length, bytes),
+//   uint32 CRC32 of everything before it
+// It is empty (or missing) whenever the data file is complete.
+#define DWB_MAGIC 0x31425744u  // "DWB1"
+
+// One write of an update: length bytes at offset of the data file
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+    const unsigned char *data;
+} Patch;
+
+static void doubleWritePath(const char *path, char *dwb, size_t size) {
+    snprintf(dwb, size, "%s.dwb", path);
+}
+
+// Read the double-write file of path into *dwb (freed by the caller). Returns 1 if it is
+// complete, 0 if there is none or it was cut short while being written, -1 on errors.
+static int readDoubleWrite(const char *path, unsigned char **dwb, size_t *size) {
+    char name[280];
+    uint32_t head[2], crc;
+
+    *dwb = NULL;
+    doubleWritePath(path, name, sizeof(name));
+    FILE *fp = fopen(name, "rb");
+    if (!fp) return 0;
+
+    int64_t length = fileLength(fp);
+    if (length < (int64_t)(sizeof(head) + sizeof(crc)) || (uint64_t)length > SIZE_MAX) {
+        fclose(fp);
+        return length < 0 || (uint64_t)length > SIZE_MAX ? -1 : 0;
+    }
+    unsigned char *buf = malloc((size_t)length);
+    int ok = buf && seekFile(fp, 0) == 0 && fread(buf, 1, (size_t)length, fp) == (size_t)length;
+    fclose(fp);
+    if (!ok) {
+        free(buf);
+        return -1;
+    }
+
+    // Complete only if the CRC matches and the entries fill it exactly
+    size_t end = (size_t)length - sizeof(crc);
+    size_t pos = sizeof(head);
+    memcpy(head, buf, sizeof(head));
+    memcpy(&crc, buf + end, sizeof(crc));
+    ok = head[0] == DWB_MAGIC && crc == crc32Update(0, buf, end);
+    for (uint32_t i = 0; ok && i < head[1]; i++) {
+        uint32_t bytes;
+        if (end - pos < sizeof(uint64_t) + sizeof(bytes)) {
+            ok = 0;
+            break;
+        }
+        memcpy(&bytes, buf + pos + sizeof(uint64_t), sizeof(bytes));
+        pos += sizeof(uint64_t) + sizeof(bytes);
+        if (end - pos < bytes) ok = 0;
+        else pos += bytes;
+    }
+    if (!ok || pos != end) {
+        free(buf);
+        return 0;
+    }
+
+    *dwb = buf;
+    *size = end;
+    return 1;
+}
+
+// The next entry of a double-write file checked by readDoubleWrite; pos starts at 0
+static Patch nextPatch(const unsigned char *dwb, size_t *pos) {
+    Patch p;
+
+    if (*pos == 0) *pos = 2 * sizeof(uint32_t);
+    memcpy(&p.offset, dwb + *pos, sizeof(p.offset));
+    memcpy(&p.length, dwb + *pos + sizeof(p.offset), sizeof(p.length));
+    p.data = dwb + *pos + sizeof(p.offset) + sizeof(p.length);
+    *pos += sizeof(p.offset) + sizeof(p.length) + p.length;
+    return p;
+}
+
+static uint32_t patchCount(const unsigned char *dwb) {
+    uint32_t count;
+    memcpy(&count, dwb + sizeof(uint32_t), sizeof(count));
+    return count;
+}
+
+// Empty the double-write file of path once the data file is complete (nothing to do
+// if there is none, or it is empty already); returns 1 on success
+static int clearDoubleWrite(const char *path) {
+    char name[280];
+
+    doubleWritePath(path, name, sizeof(name));
+    FILE *fp = fopen(name, "rb");
+    if (!fp) return 1;
+    int empty = fgetc(fp) == EOF;
+    fclose(fp);
+    if (empty) return 1;
+
+    fp = fopen(name, "wb");
+    if (!fp) return 0;
+    int ok = syncStream(fp);
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+// Write the patches of a double-write file in place and fsync; returns 1 on success
+static int applyPatches(FILE *fp, const unsigned char *dwb) {
+    size_t pos = 0;
+
+    for (uint32_t i = patchCount(dwb); i > 0; i--) {
+        Patch p = nextPatch(dwb, &pos);
+        if (seekFile(fp, (int64_t)p.offset) != 0 || fwrite(p.data, 1, p.length, fp) != p.length)
+            return 0;
+    }
+    return syncStream(fp);
+}
+
+// The same patches on a copy of the file in memory, which grows if they extend it;
+// returns 1 on success
+static int patchBuffer(char **buf, size_t *size, const unsigned char *dwb) {
+    size_t pos = 0;
+
+    for (uint32_t i = patchCount(dwb); i > 0; i--) {
+        Patch p = nextPatch(dwb, &pos);
+        if (p.offset > SIZE_MAX - p.length) return 0;  // Past what fits in memory
+        size_t end = (size_t)p.offset + p.length;
+        if (end > *size) {
+            char *grown = realloc(*buf, end);
+            if (!grown) return 0;
+            memset(grown + *size, 0, end - *size);
+            *buf = grown;
+            *size = end;
+        }
+        memcpy(*buf + p.offset, p.data, p.length);
+    }
+    return 1;
+}
+
+int recFileRecover(const char *path) {
+    unsigned char *dwb;
+    size_t size;
+
+    // Cut short: the crash came before anything was written in place
+    int status = readDoubleWrite(path, &dwb, &size);
+    if (status <= 0) return status == 0 && clearDoubleWrite(path);
+
+    FILE *fp = fopen(path, "r+b");
+    int ok = fp && applyPatches(fp, dwb);
+    if (fp && fclose(fp) != 0) ok = 0;
+    free(dwb);
+    return ok && clearDoubleWrite(path);
+}
+
+// Bytes between the starts of two blocks of u, as kept in u->images
+static size_t imageStride(const RecUpdate *u) {
+    return (size_t)u->header.blockRecords * u->header.recordSize + sizeof(uint32_t);
+}
+
+// Patch i of an update: the changed blocks of the old file, then the header
+static Patch updatePatch(const RecUpdate *u, int64_t i) {
+    Patch p;
+
+    if (i == u->imageCount) {
+        p.offset = 0;
+        p.length = sizeof(u->header);
+        p.data = (const unsigned char *)&u->header;
+    } else {
+        int64_t block = u->imageBlocks[i];
+        p.offset = (uint64_t)blockOffset(&u->header, block);
+        p.length = (uint32_t)((size_t)blockLength(&u->header, block) * u->header.recordSize + sizeof(uint32_t));
+        p.data = u->images + (size_t)i * imageStride(u);
+    }
+    return p;
+}
+
+// New blocks go straight to the data file: past the old end they are not part of it
+// until the header counts them
+static void finishBlock(RecUpdate *u) {
+    if (u->block < u->oldBlocks) return;  // None, or kept in u->images for path.dwb
+
+    size_t bytes = (size_t)blockLength(&u->header, u->block) * u->header.recordSize;
+    uint32_t crc = crc32Update(0, u->fresh, bytes);
+    if (seekFile(u->fp, blockOffset(&u->header, u->block)) != 0 ||
+        fwrite(u->fresh, 1, bytes, u->fp) != bytes || fwrite(&crc, sizeof(crc), 1, u->fp) != 1)
+        u->failed = 1;
+    u->wroteNew = 1;
+}
+
+static void startBlock(RecUpdate *u, int64_t block) {
+    finishBlock(u);
+    u->block = block;
+    if (block >= u->oldBlocks) {
+        memset(u->fresh, 0, imageStride(u));
+        u->image = u->fresh;
+        return;
+    }
+
+    if (u->imageCount == u->imageCapacity) {
+        int64_t capacity = u->imageCapacity ? u->imageCapacity * 2 : 16;
+        unsigned char *images = realloc(u->images, (size_t)capacity * imageStride(u));
+        if (images) u->images = images;
+        int64_t *blocks = images ? realloc(u->imageBlocks, (size_t)capacity * sizeof(int64_t)) : NULL;
+        if (!blocks) {
+            u->failed = 1;
+            return;
+        }
+        u->imageBlocks = blocks;
+        u->imageCapacity = capacity;
+    }
+    u->image = u->images + (size_t)u->imageCount * imageStride(u);
+    u->imageBlocks[u->imageCount++] = block;
+
+    // A damaged block is left alone rather than given a fresh, valid checksum
+    if (!readBlock(u->fp, &u->old, block, u->image)) u->failed = 1;
+}
+
+int recUpdateOpen(RecUpdate *u, const char *path, uint32_t recordType, size_t recordSize) {
+    memset(u, 0, sizeof(*u));
+    u->block = -1;
+    snprintf(u->path, sizeof(u->path), "%s", path);
+
+    u->fp = fopen(path, "r+b");
+    if (!u->fp) return 0;
+    if (!readHeader(u->fp, &u->old) || u->old.recordType != recordType || u->old.recordSize != recordSize ||
+        !(u->fresh = malloc((size_t)u->old.blockRecords * recordSize + sizeof(uint32_t)))) {
+        fclose(u->fp);  // Not a file of this layout: it has to be rewritten
+        u->fp = NULL;
+        return 0;
+    }
+
+    u->header = u->old;
+    u->oldBlocks = (int64_t)((u->old.recordCount + u->old.blockRecords - 1) / u->old.blockRecords);
+    return 1;
+}
+
+void recUpdateWrite(RecUpdate *u, long index, const void *record) {
+    int64_t block = index / (long)u->header.blockRecords;
+
+    if (u->failed) return;
+    if (index < 0 || index > (long)u->header.recordCount || block < u->block) {
+        u->failed = 1;  // Past the end, or out of order
+        return;
+    }
+    if (block != u->block) startBlock(u, block);
+    if (u->failed) return;
+
+    memcpy(u->image + (size_t)(index % (long)u->header.blockRecords) * u->header.recordSize, record,
+           u->header.recordSize);
+    if (index == (long)u->header.recordCount) u->header.recordCount++;
+}
+
+// Write the patches of u to path.dwb and fsync it; returns 1 on success
+static int writeDoubleWrite(const RecUpdate *u) {
+    char name[280];
+    uint32_t head[2] = {DWB_MAGIC, (uint32_t)u->imageCount + 1};
+
+    doubleWritePath(u->path, name, sizeof(name));
+    FILE *probe = fopen(name, "rb");
+    int created = !probe;
+    if (probe) fclose(probe);
+
+    FILE *fp = fopen(name, "wb");
+    if (!fp) return 0;
+    int ok = fwrite(head, sizeof(head), 1, fp) == 1;
+    uint32_t crc = crc32Update(0, head, sizeof(head));
+    for (int64_t i = 0; ok && i <= u->imageCount; i++) {
+        Patch p = updatePatch(u, i);
+        ok = fwrite(&p.offset, sizeof(p.offset), 1, fp) == 1 && fwrite(&p.length, sizeof(p.length), 1, fp) == 1 &&
+             fwrite(p.data, 1, p.length, fp) == p.length;
+        crc = crc32Update(crc, &p.offset, sizeof(p.offset));
+        crc = crc32Update(crc, &p.length, sizeof(p.length));
+        crc = crc32Update(crc, p.data, p.length);
+    }
+    if (ok) ok = fwrite(&crc, sizeof(crc), 1, fp) == 1;
+    if (ok) ok = syncStream(fp);
+    if (fclose(fp) != 0) ok = 0;
+    return ok && (!created || syncDir(name));
+}
+
+int recUpdateClose(RecUpdate *u, uint64_t lastSeq) {
+    int ok = 0;
+
+    if (!u->fp) return 0;
+    if (!u->failed) finishBlock(u);
+
+    if (!u->failed) {
+        // The checksums of the changed blocks and of the new header
+        for (int64_t i = 0; i < u->imageCount; i++) {
+            unsigned char *image = u->images + (size_t)i * imageStride(u);
+            size_t bytes = (size_t)blockLength(&u->header, u->imageBlocks[i]) * u->header.recordSize;
+            uint32_t crc = crc32Update(0, image, bytes);
+            memcpy(image + bytes, &crc, sizeof(crc));
+        }
+        u->header.lastSeq = lastSeq;
+        u->header.headerCrc = crc32Update(0, &u->header, offsetof(RecFileHeader, headerCrc));
+
+        // New blocks on disk before the header that counts them can be; the whole update
+        // in path.dwb before a block is overwritten, so a torn write can be redone from it
+        ok = (!u->wroteNew || syncStream(u->fp)) && writeDoubleWrite(u);
+        for (int64_t i = 0; ok && i <= u->imageCount; i++) {
+            Patch p = updatePatch(u, i);
+            ok = seekFile(u->fp, (int64_t)p.offset) == 0 && fwrite(p.data, 1, p.length, u->fp) == p.length;
+        }
+        ok = ok && syncStream(u->fp) && clearDoubleWrite(u->path);
+    }
+
+    if (fclose(u->fp) != 0) ok = 0;
+    free(u->fresh);
+    free(u->images);
+    free(u->imageBlocks);
+    memset(u, 0, sizeof(*u));
+    return ok;
+}
+
+// ---------- Loading ----------
+
+// Validate a whole file held in memory and hand out its records. Records sit at fixed
+// offsets, so a damaged block costs only its own records (handed out all-zero, the
+// free record, so the ones after it keep their index); only a truncation ends the load.
+static int loadBuffer(const char *data, size_t size, uint32_t recordType, size_t recordSize,
+                      RecFileCallback callback, void *ctx, RecFileHeader *info, long *lost) {
+    RecFileHeader h;
+
+    if (size < sizeof(uint32_t) || memcmp(data, &(uint32_t){RECFILE_MAGIC}, sizeof(uint32_t)) != 0)
+        return RECFILE_LEGACY;
+    if (size < sizeof(h)) return RECFILE_BAD_HEADER;
+
+    memcpy(&h, data, sizeof(h));
+    if (!headerValid(&h) || h.recordType != recordType) return RECFILE_BAD_HEADER;
+    if (info) *info = h;
+
+    // Records written by an older, smaller layout are copied into a zero-filled record;
+    // zero stands in for the records of a damaged block
+    unsigned char *padded = NULL;
+    unsigned char *zero = calloc(1, recordSize > h.recordSize ? recordSize : h.recordSize);
+    if (h.recordSize < recordSize) padded = calloc(1, recordSize);
+    if (!zero || (h.recordSize < recordSize && !padded)) {
+        free(zero);
+        free(padded);
+        return RECFILE_IO_ERROR;
+    }
+
+    int status = RECFILE_OK;
+    long index = 0, damaged = 0;
+    for (int64_t block = 0; index < (long)h.recordCount; block++) {
+        long n = blockLength(&h, block);
+        int64_t offset = blockOffset(&h, block);
+        size_t bytes = (size_t)n * h.recordSize;
+        uint32_t crc;
+
+        if ((uint64_t)offset + bytes + sizeof(crc) > size) {
+            status = RECFILE_CORRUPT;  // Truncated: the records after the cut are gone
+            break;
+        }
+        size_t pos = (size_t)offset;
+        memcpy(&crc, data + pos + bytes, sizeof(crc));
+        int intact = crc == crc32Update(0, data + pos, bytes);
+        if (!intact) {
+            status = RECFILE_CORRUPT;
+            damaged += n;
+        }
+
+        for (long i = 0; i < n; i++, index++) {
+            const char *record = intact ? data + pos + (size_t)i * h.recordSize : (const char *)zero;
+            if (padded && intact) {
+                memcpy(padded, record, h.recordSize);
+                record = (const char *)padded;
+            }
+            if (!callback(record, index, ctx)) {
+                status = RECFILE_ABORTED;
+                break;
+            }
+        }
+        if (status == RECFILE_ABORTED) break;
+    }
+
+    if (lost) *lost = damaged + (long)h.recordCount - index;
+    if (info) info->recordCount = (uint64_t)index;  // Records handed out
+    free(zero);
+    free(padded);
+    return status;
+}
+
+// Load path, from a read-only mapping when possible, else from one buffered read.
+// An update cut short by a crash is redone in memory (the file is not written).
+// Records handed to callback may be unaligned: copy them out with memcpy.
+int recFileLoad(const char *path, uint32_t recordType, size_t recordSize,
+                RecFileCallback callback, void *ctx, RecFileHeader *info, long *lost) {
+    unsigned char *dwb;
+    size_t size, dwbSize;
+    int status;
+
+    if (info) memset(info, 0, sizeof(*info));
+    if (lost) *lost = 0;
+
+    int pending = readDoubleWrite(path, &dwb, &dwbSize);
+    if (pending < 0) return RECFILE_IO_ERROR;
+
+    const char *data = pending ? NULL : mapFile(path, &size);
+    if (data) {
+        status = loadBuffer(data, size, recordType, recordSize, callback, ctx, info, lost);
+        unmapFile(data, size);
+        return status;
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        free(dwb);
+        return RECFILE_MISSING;
+    }
+
+    // A file too big for memory is an error, not a missing file that a checkpoint replaces
+    char *buf = NULL;
+    size = 0;
+    int64_t length = fileLength(fp);
+    if (length > 0 && (uint64_t)length <= SIZE_MAX && seekFile(fp, 0) == 0 && (buf = malloc((size_t)length)))
+        size = fread(buf, 1, (size_t)length, fp);
+    fclose(fp);
+
+    if (size == 0) status = length == 0 ? RECFILE_MISSING : RECFILE_IO_ERROR;
+    else if (pending && !patchBuffer(&buf, &size, dwb)) status = RECFILE_IO_ERROR;
+    else status = loadBuffer(buf, size, recordType, recordSize, callback, ctx, info, lost);
+    free(buf);
+    free(dwb);
+    return status;
+}
+
+// ---------- Damaged files ----------
+
+int recFileBackup(const char *path, char *backup, size_t size) {
+    char buf[8192];
+    size_t n;
+    int ok = 1;
+
+    // The first name not taken yet: path.bad, path.bad.1, path.bad.2, ...
+    FILE *probe = NULL;
+    for (int i = 0; i < 1000; i++) {
+        if (i == 0) snprintf(backup, size, "%s.bad", path);
+        else snprintf(backup, size, "%s.bad.%d", path, i);
+        probe = fopen(backup, "rb");
+        if (!probe) break;
+        fclose(probe);
+    }
+    if (probe) return 0;  // 1000 backups: leave them to the user
+
+    // A copy, so path stays in place until the file that replaces it is complete
+    FILE *in = fopen(path, "rb");
+    if (!in) return 0;
+    FILE *out = fopen(backup, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) ok = fwrite(buf, 1, n, out) == n;
+    if (ferror(in)) ok = 0;
+    fclose(in);
+    if (ok) ok = syncStream(out);  // On disk before the damaged file is replaced
+    if (fclose(out) != 0) ok = 0;
+    if (ok) ok = syncDir(backup);
+    if (!ok) remove(backup);
+    return ok;
+}
+
+// ---------- Writer ----------
+
+static void flushBlock(RecWriter *w) {
+    size_t bytes = (size_t)w->inBlock * w->header.recordSize;
+    uint32_t crc = crc32Update(0, w->block, bytes);
+
+    if (fwrite(w->block, 1, bytes, w->fp) != bytes || fwrite(&crc, sizeof(crc), 1, w->fp) != 1)
+        w->failed = 1;
+    w->inBlock = 0;
+}
+
+int recWriterOpen(RecWriter *w, const char *path, uint32_t recordType, size_t recordSize, uint64_t lastSeq) {
+    memset(w, 0, sizeof(*w));
+    initHeader(&w->header, recordType, recordSize, lastSeq);
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    snprintf(w->tmpPath, sizeof(w->tmpPath), "%s.tmp", path);
+
+    w->block = malloc((size_t)w->header.blockRecords * recordSize);
+    w->fp = w->block ? fopen(w->tmpPath, "wb") : NULL;
+    if (!w->fp) {
+        free(w->block);
+        w->block = NULL;
+        return 0;
+    }
+
+    // Placeholder header, rewritten with the final count on close
+    if (fwrite(&w->header, sizeof(w->header), 1, w->fp) != 1) w->failed = 1;
+    return 1;
+}
+
+void recWriterAdd(RecWriter *w, const void *record) {
+    memcpy(w->block + (size_t)w->inBlock * w->header.recordSize, record, w->header.recordSize);
+    w->inBlock++;
+    w->header.recordCount++;
+    if (w->inBlock == w->header.blockRecords) flushBlock(w);
+}
+
+int recWriterClose(RecWriter *w) {
+    if (!w->fp) return 0;
+
+    if (w->inBlock > 0) flushBlock(w);
+    if (!writeHeader(w->fp, &w->header)) w->failed = 1;
+    if (!w->failed && !syncStream(w->fp)) w->failed = 1;  // The new file is complete on disk before it replaces path
+    if (fclose(w->fp) != 0) w->failed = 1;
+    free(w->block);
+    w->fp = NULL;
+    w->block = NULL;
+
+    if (w->failed) {
+        remove(w->tmpPath);
+        return 0;
+    }
+
+    // An update of the old file left in path.dwb must not be redone on the new one
+    if (clearDoubleWrite(w->path) && replaceFile(w->tmpPath, w->path)) return 1;
+    remove(w->tmpPath);
+    return 0;
+}
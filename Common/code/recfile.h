@@ -0,0 +1,170 @@
+/*
+==============================================
+   Shared record file format - C
+==============================================
+
+The on-disk format used by students.dat (Student Record System) and
+tasks.dat (To-Do List):
+
+  +--------------------------------------+
+  | 64-byte header (RecFileHeader)       |
+  +--------------------------------------+
+  | block 0: blockRecords records        |
+  | CRC32 of block 0                     |
+  +--------------------------------------+
+  | block 1 ...                          |
+  +--------------------------------------+
+  | last block (may be partial) + CRC32  |
+  +--------------------------------------+
+
+- The header starts with a magic number and carries the format version,
+  the record type and size, the record count and its own CRC32
+- Every block of records is followed by the CRC32 of its bytes, so a
+  truncated or damaged file is detected in one linear pass; records sit
+  at fixed offsets, so a damaged block loses only its own records
+- recordSize is stored in the header: a newer program with a bigger
+  record reads older files directly (the missing tail of every record
+  is zero-filled), so adding fields does not need a migration
+- Files without a header (written before this format) are reported as
+  RECFILE_LEGACY so the program can convert them once
+- Blocks changed in place are written to path.dwb first (double write),
+  so a write torn by a crash is redone from there at the next start
+
+All integers are stored in the byte order of the machine that wrote the
+file (little-endian on every platform these projects run on).
+
+Author: Vaggelis Papaioannou
+*/
+
+#ifndef RECFILE_H
+#define RECFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECFILE_MAGIC 0x43455246u  // "FREC" in the first four bytes of the file
+#define RECFILE_VERSION 1
+#define RECFILE_HEADER_SIZE 64
+#define RECFILE_BLOCK_RECORDS 128  // Records per checksummed block
+
+// Record types
+#define RECTYPE_STUDENT 1
+#define RECTYPE_TASK 2
+
+// Results of recFileLoad
+#define RECFILE_OK 0
+#define RECFILE_MISSING 1      // No file (or an empty one)
+#define RECFILE_LEGACY 2       // File without a header
+#define RECFILE_CORRUPT 3      // Damaged blocks (their records load as all-zero) or a truncated file
+#define RECFILE_BAD_HEADER 4   // Damaged header, other record type or unknown version: nothing loaded
+#define RECFILE_ABORTED 5      // The record callback stopped the load
+#define RECFILE_IO_ERROR 6
+
+// File header, exactly RECFILE_HEADER_SIZE bytes
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t recordSize;    // Size of one record when the file was written
+    uint32_t blockRecords;
+    uint32_t recordType;
+    uint32_t flags;         // Reserved, 0
+    uint64_t recordCount;
+    uint64_t lastSeq;       // Last journal sequence number in the file (0 without a journal)
+    uint8_t reserved[20];   // 0, for future fields
+    uint32_t headerCrc;     // CRC32 of all the bytes before it
+} RecFileHeader;
+
+// Called once per record while loading; return 0 to stop the load
+typedef int (*RecFileCallback)(const void *record, long index, void *ctx);
+
+// Buffered writer that creates a whole file (written to path.tmp, fsynced and renamed
+// over path on close, so path is always either the old file or the complete new one)
+typedef struct {
+    FILE *fp;
+    char path[260];
+    char tmpPath[264];
+    RecFileHeader header;
+    unsigned char *block;   // The block being filled
+    uint32_t inBlock;       // Records in it
+    int failed;
+} RecWriter;
+
+// An update in progress (recUpdateOpen)
+typedef struct {
+    FILE *fp;
+    char path[260];
+    RecFileHeader old;          // The header before the update
+    RecFileHeader header;       // And after it
+    int64_t oldBlocks;          // Blocks of the file before the update
+    int64_t block;              // Block being changed (-1 before the first)
+    unsigned char *image;       // Its records
+    unsigned char *fresh;       // The image of a new block
+    unsigned char *images;      // Images of the changed old blocks, kept for path.dwb
+    int64_t *imageBlocks;       // Their block numbers
+    int64_t imageCount;
+    int64_t imageCapacity;
+    int wroteNew;               // New blocks were written past the old end
+    int failed;
+} RecUpdate;
+
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len);
+
+// Map a whole file read-only; returns NULL if it is missing, empty or cannot be mapped
+const char *mapFile(const char *path, size_t *size);
+void unmapFile(const char *data, size_t size);
+
+// Validate path and pass every record to callback, resized to recordSize. The records
+// of a damaged block are passed as all-zero records; a truncated file ends the load.
+// info (may be NULL) receives the header of the file, or a zeroed header, with
+// recordCount set to the records passed; lost (may be NULL) the records that could
+// not be read. An update left in path.dwb is applied to what is loaded, not to path.
+int recFileLoad(const char *path, uint32_t recordType, size_t recordSize,
+                RecFileCallback callback, void *ctx, RecFileHeader *info, long *lost);
+
+// Redo an update of path that a crash cut short (see recUpdateClose), so path is whole
+// again; returns 1 on success, also when there is nothing to redo
+int recFileRecover(const char *path);
+
+// In-place update of an existing file: records changed in place or appended, in
+// ascending index order, then the new lastSeq. Returns 0 if path is missing or has
+// another layout (it has to be rewritten); any failure makes recUpdateClose return 0.
+int recUpdateOpen(RecUpdate *u, const char *path, uint32_t recordType, size_t recordSize);
+void recUpdateWrite(RecUpdate *u, long index, const void *record);  // index <= record count
+
+// Write the update: new blocks past the old end first, then the whole changed blocks
+// and the new header to path.dwb (fsynced), then the same blocks in place. path.dwb is
+// emptied once path is on disk, so a torn block is always either redone from it or
+// not touched yet. Returns 1 if the update is on disk.
+int recUpdateClose(RecUpdate *u, uint64_t lastSeq);
+
+// Locks of path and its journal, byte ranges of path.lock (created once, never removed;
+// the system drops the locks of a process when it ends, also on a crash)
+#define RECFILE_LOCK_WRITER 0  // Exclusive, held by the one process that writes the files
+#define RECFILE_LOCK_FILES 1   // Shared while the files are read, exclusive while a checkpoint writes them
+
+// Flags of recFileLock
+#define RECFILE_LOCK_SHARED 1
+#define RECFILE_LOCK_WAIT 2    // Wait for the other processes instead of returning 0
+
+// Open path.lock, creating it if needed (read-only if it cannot be created); returns 1
+// with the handle in *lock
+int recFileLockOpen(const char *path, intptr_t *lock);
+
+// Take lock which (RECFILE_LOCK_*); returns 1 if taken, 0 if another process holds it,
+// -1 on errors
+int recFileLock(intptr_t lock, int which, int flags);
+void recFileUnlock(intptr_t lock, int which);
+void recFileLockClose(intptr_t lock);  // Releases every lock taken through it
+
+// Copy a damaged file, before it is rewritten, to the first free name of path.bad,
+// path.bad.1, ... (an older backup is never replaced). The name goes to backup
+// (of size bytes). Returns 1 on success.
+int recFileBackup(const char *path, char *backup, size_t size);
+
+int recWriterOpen(RecWriter *w, const char *path, uint32_t recordType, size_t recordSize, uint64_t lastSeq);
+void recWriterAdd(RecWriter *w, const void *record);
+int recWriterClose(RecWriter *w);  // Returns 1 if the new file replaced path
+
+#endif
@@ -0,0 +1,259 @@
+/*
+==============================================
+   Record store - C
+==============================================
+
+Implementation of recstore.h. Compile it with recfile.c and journal.c, e.g.:
+
+gcc -o todolist todolist.c ../../Common/code/recfile.c ../../Common/code/journal.c ../../Common/code/recstore.c
+
+Author: Vaggelis Papaioannou
+*/
+
+#include "recstore.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void recStoreInit(RecStore *rs, const RecSchema *schema, void *ctx) {
+    memset(rs, 0, sizeof(*rs));
+    rs->schema = schema;
+    rs->ctx = ctx;
+    rs->lastCheckpoint = time(NULL);
+}
+
+int recStoreLock(RecStore *rs) {
+    if (rs->locked) return 1;
+    if (!rs->lockOpen) rs->lockOpen = recFileLockOpen(rs->schema->dataPath, &rs->lock);
+    if (!rs->lockOpen) return -1;
+
+    int status = recFileLock(rs->lock, RECFILE_LOCK_WRITER, 0);
+    rs->locked = status == 1;
+    return status;
+}
+
+// Shared or exclusive, the files lock keeps readers and checkpoints apart (nothing to
+// do for a store without a lock file)
+static void lockFiles(RecStore *rs, int flags) {
+    if (rs->lockOpen && !rs->filesLocked)
+        rs->filesLocked = recFileLock(rs->lock, RECFILE_LOCK_FILES, flags | RECFILE_LOCK_WAIT) == 1;
+}
+
+static void unlockFiles(RecStore *rs) {
+    if (rs->filesLocked) recFileUnlock(rs->lock, RECFILE_LOCK_FILES);
+    rs->filesLocked = 0;
+}
+
+int recStoreLoad(RecStore *rs) {
+    const RecSchema *s = rs->schema;
+
+    // A reader holds the files lock, shared, until its journal is replayed, so no
+    // checkpoint changes the data file or empties the journal in between
+    if (rs->readOnly) {
+        if (!rs->lockOpen) rs->lockOpen = recFileLockOpen(s->dataPath, &rs->lock);
+        lockFiles(rs, RECFILE_LOCK_SHARED);
+    }
+
+    // An update a crash cut short is finished first (a read-only store only reads it)
+    if (!rs->readOnly) {
+        lockFiles(rs, 0);
+        int recovered = recFileRecover(s->dataPath);
+        unlockFiles(rs);
+        if (!recovered) {
+            rs->loadStatus = RECFILE_IO_ERROR;
+            return RECFILE_IO_ERROR;
+        }
+    }
+
+    int status = recFileLoad(s->dataPath, s->recordType, s->recordSize, s->load, rs->ctx, &rs->info,
+                             &rs->lostRecords);
+
+    switch (status) {
+        case RECFILE_OK:
+            // Row i is record i, so a checkpoint can write changed rows in place,
+            // unless the records have another size (written by an older version)
+            rs->fileRecords = (long)rs->info.recordCount;
+            rs->rewrite = rs->info.recordSize != s->recordSize;
+            break;
+        case RECFILE_MISSING:
+            break;  // First run: the first checkpoint creates the file
+        case RECFILE_LEGACY:
+            rs->rewrite = 1;  // Converted at the first checkpoint
+            if (s->loadLegacy && s->loadLegacy(s->dataPath, rs->ctx)) break;
+            status = RECFILE_CORRUPT;
+            rs->backupPending = 1;
+            break;
+        case RECFILE_CORRUPT:
+        case RECFILE_BAD_HEADER:
+            // Rewritten from what could be read, but only by a checkpoint (never by a
+            // read-only store), and only once the damaged file has been copied aside
+            rs->rewrite = 1;
+            rs->backupPending = 1;
+            break;
+        default:
+            break;  // Nothing is known about the file: leave it alone
+    }
+
+    rs->journal.seq = rs->info.lastSeq;
+    rs->loadStatus = status;
+    return status;
+}
+
+// Replays one journal entry (called by journalReplay)
+static int replayEntry(uint32_t op, uint64_t seq, const void *payload, uint32_t length, void *ctx) {
+    RecStore *rs = ctx;
+    rs->journal.seq = seq;
+    if (!rs->schema->apply(op, payload, length, rs->ctx)) rs->skipped++;
+    return 1;
+}
+
+int recStoreReplay(RecStore *rs) {
+    const RecSchema *s = rs->schema;
+    uint64_t lastSeq;
+    long entries;
+
+    // Entries up to info.lastSeq are already in the data file
+    rs->replayed = journalReplay(s->journalPath, rs->info.lastSeq, replayEntry, rs, &lastSeq, &entries);
+    rs->lastCheckpoint = time(NULL);
+    if (rs->readOnly) {
+        unlockFiles(rs);
+        return 1;  // The journal and the data file are left for the next writer
+    }
+
+    int open = journalOpen(&rs->journal, s->journalPath, lastSeq, s->syncEvery);
+    if (entries > 0) rs->rewrite = 1;  // After a crash the file may be half updated
+    if (rs->rewrite) {
+        recStoreCheckpoint(rs);  // Checkpoint the replayed changes
+    } else {
+        lockFiles(rs, 0);
+        journalReset(&rs->journal);  // Drops a torn entry left by a crash
+        unlockFiles(rs);
+    }
+    return open;
+}
+
+int recStoreLog(RecStore *rs, uint32_t op, const void *payload, uint32_t length) {
+    if (rs->journal.fp && !journalAppend(&rs->journal, op, payload, length)) return 0;
+    rs->changes++;
+    return 1;
+}
+
+int recStoreChange(RecStore *rs, uint32_t op, const void *payload, uint32_t length) {
+    if (!recStoreLog(rs, op, payload, length)) return RECSTORE_JOURNAL_FAILED;
+    return rs->schema->apply(op, payload, length, rs->ctx) ? 1 : 0;
+}
+
+void recStoreMarkDirty(RecStore *rs, long row) {
+    if (rs->rewrite || row >= rs->fileRecords || (row < rs->dirtyCapacity && rs->dirty[row])) return;
+
+    // Only rows that are in the file can be dirty, so the arrays never outgrow it
+    if (row >= rs->dirtyCapacity) {
+        long capacity = rs->fileRecords;
+        unsigned char *dirty = realloc(rs->dirty, capacity);
+        if (dirty) rs->dirty = dirty;
+        long *dirtyList = realloc(rs->dirtyList, capacity * sizeof(long));
+        if (dirtyList) rs->dirtyList = dirtyList;
+        if (!dirty || !dirtyList) {
+            rs->rewrite = 1;  // Out of memory: write everything instead
+            return;
+        }
+        memset(rs->dirty + rs->dirtyCapacity, 0, capacity - rs->dirtyCapacity);
+        rs->dirtyCapacity = capacity;
+    }
+
+    rs->dirty[row] = 1;
+    rs->dirtyList[rs->dirtyCount++] = row;
+}
+
+int recStoreDue(const RecStore *rs) {
+    if (rs->changes == 0) return 0;
+    if (rs->changes >= rs->schema->checkpointEvery) return 1;
+    return rs->schema->autosaveSeconds > 0 && time(NULL) - rs->lastCheckpoint >= rs->schema->autosaveSeconds;
+}
+
+// Writes every row to a new file that replaces the data file only once it is complete
+static int writeAll(RecStore *rs, long rows, unsigned char *buffer) {
+    const RecSchema *s = rs->schema;
+    RecWriter w;
+
+    if (!recWriterOpen(&w, s->dataPath, s->recordType, s->recordSize, rs->journal.seq)) return 0;
+    for (long row = 0; row < rows; row++) recWriterAdd(&w, s->record(row, buffer, rs->ctx));
+    return recWriterClose(&w);
+}
+
+static int compareRows(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// Writes the rows changed since the last checkpoint in place, appends the new ones and
+// stores the journal position, as one update that a torn write cannot break (see
+// recUpdateClose); the cost is proportional to the blocks changed.
+static int writeChanged(RecStore *rs, long rows, unsigned char *buffer) {
+    const RecSchema *s = rs->schema;
+    RecUpdate u;
+
+    if (rows < rs->fileRecords) return 0;  // Rows were removed from the end: rewrite
+    if (rs->dirtyCount == 0 && rows == rs->fileRecords && rs->changes == 0) return 1;  // Nothing changed
+    if (!recUpdateOpen(&u, s->dataPath, s->recordType, s->recordSize)) return 0;
+    if ((long)u.old.recordCount != rs->fileRecords) u.failed = 1;  // Not the file that was loaded
+
+    // The update takes the records in file order
+    if (rs->dirtyCount > 1) qsort(rs->dirtyList, rs->dirtyCount, sizeof(long), compareRows);
+    for (long i = 0; i < rs->dirtyCount; i++) {
+        long row = rs->dirtyList[i];
+        recUpdateWrite(&u, row, s->record(row, buffer, rs->ctx));
+    }
+    for (long row = rs->fileRecords; row < rows; row++) recUpdateWrite(&u, row, s->record(row, buffer, rs->ctx));
+    return recUpdateClose(&u, rs->journal.seq);
+}
+
+int recStoreCheckpoint(RecStore *rs) {
+    if (rs->readOnly) return 1;
+
+    const RecSchema *s = rs->schema;
+    long rows = s->rowCount(rs->ctx);
+    unsigned char *buffer = malloc(s->recordSize);
+
+    // Readers wait until the data file and the journal agree again
+    lockFiles(rs, 0);
+
+    // Only the changed rows, or the whole file when it does not match the rows.
+    // A damaged file is only replaced once a copy of it is safe.
+    int full = 0;
+    int ok = buffer && !rs->rewrite && writeChanged(rs, rows, buffer);
+    if (!ok && buffer && rs->backupPending &&
+        recFileBackup(s->dataPath, rs->backupPath, sizeof(rs->backupPath)))
+        rs->backupPending = 0;
+    if (!ok && buffer && !rs->backupPending) ok = full = writeAll(rs, rows, buffer);
+    free(buffer);
+
+    // The journaled changes are in the data file now, and on disk: the journal can go
+    if (ok) {
+        rs->checkpoints++;
+        rs->fullRewrites += full;
+        rs->recordsWritten += full ? rows : rs->dirtyCount + rows - rs->fileRecords;
+        for (long i = 0; i < rs->dirtyCount; i++) rs->dirty[rs->dirtyList[i]] = 0;
+        rs->dirtyCount = 0;
+        rs->fileRecords = rows;
+        rs->rewrite = 0;
+        rs->changes = 0;
+        journalReset(&rs->journal);
+    } else {
+        rs->rewrite = 1;  // The file may be half written: the journal still has everything
+    }
+    unlockFiles(rs);
+    rs->lastCheckpoint = time(NULL);
+    return ok;
+}
+
+void recStoreClose(RecStore *rs) {
+    journalClose(&rs->journal);
+    if (rs->lockOpen) recFileLockClose(rs->lock);
+    rs->lockOpen = rs->locked = rs->filesLocked = 0;
+    free(rs->dirty);
+    free(rs->dirtyList);
+    rs->dirty = NULL;
+    rs->dirtyList = NULL;
+    rs->dirtyCount = rs->dirtyCapacity = 0;
+}
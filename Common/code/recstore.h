@@ -0,0 +1,154 @@
+/*
+==============================================
+   Record store - C
+==============================================
+
+The storage engine shared by the Student Record System and the To-Do
+List: one data file in the record file format (recfile.h) plus its
+journal (journal.h), kept in step with a table of rows in memory.
+
+The program describes its records once in a RecSchema: the file names,
+the record type and size, and five callbacks that connect the engine to
+its own table and indexes:
+
+- load:       receives the records of the data file in order (record i
+              is row i of the table)
+- loadLegacy: reads a data file written before the record file format
+- apply:      makes one change (add, edit, delete, ...) to the table; it
+              is called for new changes and again for journaled ones at
+              startup, so applying a change twice must be harmless
+- rowCount, record: the rows to write back; an all-zero record is a
+              free row (deleted, its place kept so row numbers stay put)
+
+Life of a store:
+
+  recStoreInit -> (recStoreLock) -> recStoreLoad -> (build the indexes) -> recStoreReplay
+    -> recStoreChange ... (recStoreDue -> recStoreCheckpoint) ...
+    -> recStoreCheckpoint -> recStoreClose
+
+- Every change is journaled before it is applied; a checkpoint stores
+  the journal position in the data file, fsyncs it and only then
+  empties the journal, so a power loss never loses a saved change
+- A checkpoint writes only the rows marked with recStoreMarkDirty (in
+  place, their blocks through the double-write file of recfile.h) and
+  appends the new rows; the whole file is rewritten (to a temporary file,
+  then renamed) only when it does not match the rows
+- A damaged file is copied to *.bad and rewritten from what could be
+  read at the first checkpoint; old files are converted then too
+- A store opened read-only (readOnly set after recStoreInit) never
+  writes: the journal is replayed in memory and checkpoints do nothing
+- Only one process at a time writes the files: it holds the writer lock
+  taken by recStoreLock. Its checkpoints take the files lock, exclusive;
+  a read-only store holds it shared while it loads the data file and
+  replays the journal, so it never sees a checkpoint half done
+
+The engine prints nothing: results are return values and fields of the
+RecStore, and the program words its own messages.
+
+Author: Vaggelis Papaioannou
+*/
+
+#ifndef RECSTORE_H
+#define RECSTORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "recfile.h"
+#include "journal.h"
+
+#define RECSTORE_JOURNAL_FAILED -1  // recStoreChange: the journal could not be written, nothing changed
+
+// The records of one program; ctx is the one given to recStoreInit
+typedef struct {
+    const char *dataPath;     // e.g. "tasks.dat"
+    const char *journalPath;  // e.g. "tasks.jnl"
+    uint32_t recordType;      // RECTYPE_*
+    size_t recordSize;
+    int syncEvery;            // fsync the journal after every N changes (0 = leave it to the OS)
+    long checkpointEvery;     // Changes between checkpoints
+    int autosaveSeconds;      // Changes older than this are due for a checkpoint (0 = never)
+
+    RecFileCallback load;
+    int (*loadLegacy)(const char *path, void *ctx);  // Returns 0 if the file is damaged (may be NULL)
+    int (*apply)(uint32_t op, const void *payload, uint32_t length, void *ctx);  // Returns 0 if refused
+    long (*rowCount)(void *ctx);
+    const void *(*record)(long row, void *buffer, void *ctx);  // Record of row; buffer has recordSize bytes
+} RecSchema;
+
+typedef struct {
+    const RecSchema *schema;
+    void *ctx;
+    Journal journal;
+    int readOnly;             // Set before recStoreLoad: the files are only read
+    intptr_t lock;            // dataPath.lock (see RECFILE_LOCK_WRITER, RECFILE_LOCK_FILES)
+    int lockOpen;
+    int locked;               // recStoreLock took the writer lock
+    int filesLocked;          // The files lock is held, shared (loading read-only) or exclusive
+    RecFileHeader info;       // Header of the data file when it was loaded
+    int loadStatus;           // Result of recStoreLoad
+    long lostRecords;         // Records of the data file that could not be read
+    int backupPending;        // The data file is damaged: copy it aside before replacing it
+    char backupPath[280];     // Where the damaged file was copied ("" if it was not)
+    long replayed;            // Journal entries applied by recStoreReplay
+    long skipped;             // Of those, refused by apply
+    long changes;             // Changes since the last checkpoint
+    int rewrite;              // The data file does not match the rows: the next checkpoint rewrites it
+    long fileRecords;         // Rows that have a record in the data file
+    unsigned char *dirty;     // dirty[row]: changed since the last checkpoint (rows < fileRecords only)
+    long *dirtyList;          // The dirty rows, so a checkpoint does not scan the table
+    long dirtyCount;
+    long dirtyCapacity;
+    time_t lastCheckpoint;
+
+    // Counters for benchmarks and tuning (never reset)
+    long checkpoints;         // Successful checkpoints
+    long fullRewrites;        // Of those, how many rewrote the whole file
+    long recordsWritten;      // Records written by checkpoints, in place, appended or rewritten
+} RecStore;
+
+void recStoreInit(RecStore *rs, const RecSchema *schema, void *ctx);
+
+// Take the writer lock of the data file and its journal. A store that writes holds
+// it from before recStoreLoad until recStoreClose, so two processes never write the
+// same files. Returns 1 if taken, 0 if another process holds it, -1 if the lock file
+// (dataPath.lock) could not be opened.
+int recStoreLock(RecStore *rs);
+
+// Pass the records of the data file to schema->load. Of a damaged file the readable
+// records are used (RECFILE_CORRUPT, also for an unreadable old file; rs->lostRecords
+// counts the others); of a file in another format none (RECFILE_BAD_HEADER). Either
+// is copied to *.bad by the checkpoint that replaces it. RECFILE_IO_ERROR and
+// RECFILE_ABORTED leave the file alone. Returns the status, also kept in rs->loadStatus.
+// A checkpoint a crash cut short is finished first (RECFILE_IO_ERROR if that fails).
+int recStoreLoad(RecStore *rs);
+
+// Apply the journaled changes the data file does not have yet and open the journal.
+// Checkpoints if anything was replayed or the file needs rewriting (rs->rewrite is
+// still set afterwards if that failed). Returns 1 if the journal is open (always 1
+// for a read-only store, which only applies the changes in memory).
+int recStoreReplay(RecStore *rs);
+
+// Journal a change, then apply it. Returns 1 on success, 0 if apply refused it,
+// RECSTORE_JOURNAL_FAILED if it could not be journaled. Without an open journal
+// the change is only applied.
+int recStoreChange(RecStore *rs, uint32_t op, const void *payload, uint32_t length);
+
+// Journal a change the program has already made to its table; returns 1 on success
+int recStoreLog(RecStore *rs, uint32_t op, const void *payload, uint32_t length);
+
+// Row changed: written in place at the next checkpoint (new rows need no mark)
+void recStoreMarkDirty(RecStore *rs, long row);
+
+// 1 if enough changes have piled up, or they have waited autosaveSeconds
+int recStoreDue(const RecStore *rs);
+
+// Write the changed rows (or the whole file) and empty the journal; returns 1 on success
+// (a read-only store writes nothing)
+int recStoreCheckpoint(RecStore *rs);
+
+// Close the journal, release the locks and free the store (does not checkpoint)
+void recStoreClose(RecStore *rs);
+
+#endif
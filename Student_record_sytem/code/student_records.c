@@ -7,18 +7,44 @@ A terminal-based tool to manage student records:
 - Add new students (first name, last name, roll number)
 - Display all students in a formatted table
 - Search by roll number or last name
-- Delete student records
-- Export data to CSV for use in Excel
-- Data is saved persistently in students.dat
+- Delete student records (marked in place; the file is compacted when
+  enough deleted records pile up, or on demand from the menu)
+- Export data to CSV (for Excel; fields with commas or quotes are quoted)
+  or JSON Lines, to a file or to stdout
+- Bulk import from a CSV in the same layout (Roll,First Name,Last Name);
+  rejected rows are reported with their line number
+- Data is saved persistently in students.dat, in the shared record file
+  format (Common/code/recfile.h): versioned header and a CRC per block of
+  records, so a damaged file is detected when it is loaded
+- Records are loaded once into a growable in-memory store (no limit on
+  the number of students); displays, searches and exports read from it
+- Every change is first appended to a journal (students.jnl), so a crash
+  loses nothing; the journal is replayed at startup and emptied at
+  checkpoints (on exit and every CHECKPOINT_EVERY changes), which write
+  only the changed records of students.dat in place and append the new
+  ones (the record store shared with the To-Do List, Common/code/recstore.h)
+- students.dat is memory-mapped at startup and loaded straight from the
+  mapping (falls back to one buffered read)
+- Roll numbers are indexed in memory, so duplicate checks and lookups
+  by roll number are a single array access
+- Last names are kept in a sorted index for exact, case-insensitive
+  and prefix searches
+- Non-interactive commands for scripts (see usage() or run with --help):
+  student_records add|get|delete|search|import|export|batch ...
 
 Author: Vaggelis Papaioannou
 
 To compile and run:
 -----------------------------------
 cd C:\
-gcc -o student_records student_records.c
+gcc -o student_records student_records.c ../../Common/code/recfile.c ../../Common/code/journal.c ../../Common/code/recstore.c
 .\student_records
 -----------------------------------
+
+Exit status of the commands: 0 = success, 1 = an operation failed
+(not found, duplicate, rejected rows), 2 = bad usage, 3 = storage error,
+also when students.dat was damaged and records were lost (the command
+still runs on the records that could be read).
 */
 
 #include <stdio.h>
@@ -26,32 +52,131 @@ gcc -o student_records student_records.c
 #include <string.h>
 #include <ctype.h>
 
+#include "../../Common/code/recfile.h"
+#include "../../Common/code/journal.h"
+#include "../../Common/code/recstore.h"
+
 // Constants
 #define FILE_NAME "students.dat"
-#define MAX_STUDENTS 100
+#define JOURNAL_FILE "students.jnl"
+#define JOURNAL_SYNC_EVERY 1     // fsync the journal after every change (0 = leave it to the OS)
+#define CHECKPOINT_EVERY 1000    // Changes between checkpoints
+#define ROLL_SLOTS 100000  // One slot per possible roll number AM00000..AM99999
+#define READ_BATCH 256     // Records per fread when converting a file of the old format
+#define ROLL_LEN 8         // "AM12345" plus the terminator
+#define COMPACT_MIN_DEAD 64  // Compact only once this many deleted records have piled up...
+#define COMPACT_RATIO 4      // ...and they are more than 1 in COMPACT_RATIO records
+#define CSV_LINE 256         // Longest accepted line of an imported CSV
+#define EXPORT_BUFFER (1 << 20)  // Bytes of formatted output collected per write
 
-// Structure for student record
+// Structure for student record (the layout of one record in students.dat)
 struct Student {
     char firstName[50];
     char lastName[50];
     char roll[10];  // Roll number as string
 };
 
-// Global student list (in-memory)
-struct Student students[MAX_STUDENTS];
-int studentCount = 0;  // In-memory count
+// In-memory student store, one row per record of students.dat (row i = record i).
+// Instead of 110-byte structs it keeps a column of 8-byte roll numbers and, for
+// the names, offsets into one shared pool where every distinct name is stored once.
+// A deleted record (tombstone) has an empty roll number, in the file and here.
+struct StudentStore {
+    char (*rolls)[ROLL_LEN];
+    long *firstNames;     // Offsets into names
+    long *lastNames;
+    long count;           // Rows, including tombstones
+    long deadCount;       // Tombstones
+    long capacity;
+
+    char *names;          // Interned names, each '\0'-terminated
+    long namesUsed;
+    long namesCapacity;
+
+    long *internTable;    // Open-addressing hash table of offsets into names, -1 = empty
+    long internCapacity;  // Power of two
+    long internCount;
+};
+
+struct StudentStore store = {0};
+
+// Roll number index: rollIndex[digits of roll] = row of that student, or -1.
+// AM12345 is stored at rollIndex[12345], so every lookup is a single array access.
+long rollIndex[ROLL_SLOTS];
+
+// Last name index: every row, sorted by last name ignoring case (ties by row),
+// so all matches for a name or prefix are next to each other
+long *nameIndex = NULL;
+long nameCount = 0;
+long nameCapacity = 0;
+
+// Last name search modes
+#define MATCH_EXACT 1
+#define MATCH_IGNORE_CASE 2
+#define MATCH_PREFIX 3
+
+// Export formats
+#define EXPORT_CSV 1
+#define EXPORT_JSONL 2
+
+// Exit status of the command line
+#define EXIT_OK 0
+#define EXIT_FAILED 1
+#define EXIT_USAGE 2
+#define EXIT_STORAGE 3
+
+// Journal operations
+#define OP_ADD 1     // Payload: struct Student
+#define OP_DELETE 2  // Payload: roll number, ROLL_LEN bytes
+
+// students.dat and its journal (Common/code/recstore.h): every change is journaled,
+// students.dat is brought up to date at checkpoints
+RecStore db;
 
 // Function declarations
 void addStudent();
 void displayStudents();
 void searchStudent();
 void deleteStudent();
+void exportStudents();
+long writeExport(FILE *out, int format);
+void importFromCSV();
+long importCSV(const char *path, long *rejected);
+long nextNameMatch(long i, const char *key, int mode);
+int runCommand(int argc, char *argv[]);
+int readOnlyCommand(const char *cmd);
+void usage();
+int compactStudents();
+int rewriteStudents();
+int checkpointStudents();
+int insertStudent(const struct Student *s);
+int removeStudent(int slot);
 void menu();
+void loadStudents(int readOnly);
+int isValidRoll(const char *roll);
+int rollSlot(const char *roll);
+long internName(const char *name);
+int storeAppend(const struct Student *s);
+int rowAlive(long row);
+const char *rowRoll(long row);
+const char *rowFirstName(long row);
+const char *rowLastName(long row);
+void rowToStudent(long row, struct Student *s);
+int compareNoCase(const char *a, const char *b, size_t n);
+int addNameEntry(long row);
+int growNameIndex();
+void sortNameIndex();
+void removeNameEntry(long row);
+long findNameStart(const char *key);
 
-int main() {
+// student_records_bench.c defines STUDENT_RECORDS_NO_MAIN to reuse everything else
+#ifndef STUDENT_RECORDS_NO_MAIN
+int main(int argc, char *argv[]) {
+    loadStudents(argc > 1 && readOnlyCommand(argv[1]));
+    if (argc > 1) return runCommand(argc, argv);  // Non-interactive command
     menu();
     return 0;
 }
+#endif // STUDENT_RECORDS_NO_MAIN
 
 // Menu interface for user options
 void menu() {
@@ -64,7 +189,9 @@ void menu() {
         printf("3. Search Student by Roll Number\n");
         printf("4. Delete Student\n");
         printf("5. Exit\n");
-        printf("6. Export Students to CSV\n");
+        printf("6. Export Students (CSV / JSON Lines)\n");
+        printf("7. Compact Data File\n");
+        printf("8. Import Students from CSV\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
 
@@ -73,8 +200,16 @@ void menu() {
             case 2: displayStudents(); break;
             case 3: searchStudent(); break;
             case 4: deleteStudent(); break;
-            case 5: printf("Exiting...\n"); exit(0);
-            case 6: exportToCSV(); break;
+            case 5:
+                checkpointStudents();
+                recStoreClose(&db);
+                printf("Exiting...\n");
+                exit(0);
+            case 6: exportStudents(); break;
+            case 7:
+                if (compactStudents()) printf(" Data file compacted.\n");
+                break;
+            case 8: importFromCSV(); break;
             default: printf("Invalid choice. Try again.\n");
         }
     }
@@ -93,19 +228,350 @@ int isValidRoll(const char *roll) {
     return 1;
 }
 
+// Index slot for a roll number (its 5 digits), or -1 if the format is invalid
+int rollSlot(const char *roll) {
+    return isValidRoll(roll) ? atoi(roll + 2) : -1;
+}
+
+// Add one record read from students.dat to the store and the indexes; returns 0 if out of memory
+static int loadRecord(const void *record, long index, void *ctx) {
+    long row = store.count;
+    (void)index;
+    (void)ctx;
+
+    if (!storeAppend(record)) {
+        fprintf(stderr, " Out of memory: only %ld records were loaded.\n", row);
+        return 0;
+    }
+    if (!rowAlive(row)) {
+        store.deadCount++;
+        return 1;
+    }
+    int slot = rollSlot(rowRoll(row));
+    if (slot >= 0) rollIndex[slot] = row;
+    if (growNameIndex()) nameIndex[nameCount++] = row;  // Sorted once loading is done
+    return 1;
+}
+
+// Read a students.dat of the old format: raw records, no header
+static int loadLegacy(const char *path, void *ctx) {
+    struct Student batch[READ_BATCH];
+    size_t n;
+    int ok = 1;
+    (void)ctx;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    while (ok && (n = fread(batch, sizeof(struct Student), READ_BATCH, fp)) > 0) {
+        for (size_t i = 0; i < n && ok; i++) ok = loadRecord(&batch[i], store.count, NULL);
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+static int addRow(const struct Student *s);
+static int deleteRow(int slot);
+
+// Apply one change, new or replayed from the journal at startup. Replayed entries
+// may already be in students.dat, so a change is only made if it still changes
+// something; returns 1 if it did.
+static int applyChange(uint32_t op, const void *payload, uint32_t length, void *ctx) {
+    (void)ctx;
+
+    if (op == OP_ADD && length == sizeof(struct Student)) {
+        struct Student s;
+        memcpy(&s, payload, sizeof(s));
+        s.roll[sizeof(s.roll) - 1] = '\0';
+        int slot = rollSlot(s.roll);
+        return slot >= 0 && rollIndex[slot] < 0 && addRow(&s);
+    }
+    if (op == OP_DELETE && length == ROLL_LEN) {
+        char roll[ROLL_LEN];
+        memcpy(roll, payload, ROLL_LEN);
+        roll[ROLL_LEN - 1] = '\0';
+        int slot = rollSlot(roll);
+        return slot >= 0 && rollIndex[slot] >= 0 && deleteRow(slot);
+    }
+    return 0;
+}
+
+// The record of a row in students.dat; a tombstone is an all-zero record
+static const void *studentRecord(long row, void *buffer, void *ctx) {
+    (void)ctx;
+    if (rowAlive(row)) rowToStudent(row, buffer);
+    else memset(buffer, 0, sizeof(struct Student));
+    return buffer;
+}
+
+static long studentRows(void *ctx) {
+    (void)ctx;
+    return store.count;
+}
+
+// How students are kept in students.dat and students.jnl
+static const RecSchema studentSchema = {
+    FILE_NAME, JOURNAL_FILE, RECTYPE_STUDENT, sizeof(struct Student),
+    JOURNAL_SYNC_EVERY, CHECKPOINT_EVERY, 0,
+    loadRecord, loadLegacy, applyChange, studentRows, studentRecord
+};
+
+// Load students.dat into the store and build both indexes with one pass at startup.
+// readOnly: for commands that only read, which never write students.dat or the journal
+// (not even to convert, repair or compact the file; the next change does that).
+void loadStudents(int readOnly) {
+    for (int i = 0; i < ROLL_SLOTS; i++) rollIndex[i] = -1;
+
+    recStoreInit(&db, &studentSchema, NULL);
+    db.readOnly = readOnly;
+
+    // One writer at a time; get, search and export only read, so they run alongside it
+    int locked = readOnly ? 1 : recStoreLock(&db);
+    if (locked != 1) {
+        if (locked == 0) fprintf(stderr, " students.dat is in use by another student_records.\n");
+        else fprintf(stderr, " Could not lock students.dat.\n");
+        exit(EXIT_STORAGE);
+    }
+    switch (recStoreLoad(&db)) {
+        case RECFILE_OK:
+        case RECFILE_MISSING:
+            break;  // No file yet: empty store
+        case RECFILE_LEGACY:
+            fprintf(stderr, " Converting students.dat to the new file format.\n");
+            break;
+        case RECFILE_CORRUPT:
+            fprintf(stderr, " students.dat is damaged: %ld records could not be read.\n", db.lostRecords);
+            break;
+        case RECFILE_BAD_HEADER:
+            // Not readable by this program: the first change starts an empty file
+            fprintf(stderr, " students.dat has a damaged header or an unknown format.\n");
+            break;
+        default:
+            fprintf(stderr, " Could not load students.dat.\n");
+            exit(EXIT_STORAGE);
+    }
+
+    sortNameIndex();
+
+    // Apply the changes made after the last checkpoint (this also writes a converted
+    // or recovered file, which must succeed before anything else is changed)
+    if (!recStoreReplay(&db)) {
+        fprintf(stderr, " Could not open the journal %s.\n", JOURNAL_FILE);
+        exit(EXIT_STORAGE);
+    }
+    if (db.replayed > 0) fprintf(stderr, " Replayed %ld changes from the journal.\n", db.replayed);
+    if (db.backupPath[0]) fprintf(stderr, " The damaged file is kept as %s\n", db.backupPath);
+    if (db.readOnly) return;
+    if (db.rewrite) {
+        fprintf(stderr, " Could not write the data file.\n");
+        exit(EXIT_STORAGE);
+    }
+
+    if (store.deadCount >= COMPACT_MIN_DEAD && store.deadCount * COMPACT_RATIO > store.count)
+        compactStudents();
+}
+
+// Hash of a name for the intern table (FNV-1a)
+static unsigned long hashName(const char *name) {
+    unsigned long h = 2166136261UL;
+    while (*name) {
+        h ^= (unsigned char)*name++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+// Offset of name in the name pool, adding it the first time it is seen; -1 if out of memory
+long internName(const char *name) {
+    // Keep the table at most half full
+    if ((store.internCount + 1) * 2 > store.internCapacity) {
+        long newCapacity = store.internCapacity ? store.internCapacity * 2 : 1024;
+        long *table = malloc(newCapacity * sizeof(long));
+        if (!table) return -1;
+        for (long i = 0; i < newCapacity; i++) table[i] = -1;
+        for (long i = 0; i < store.internCapacity; i++) {
+            long off = store.internTable[i];
+            if (off < 0) continue;
+            unsigned long h = hashName(store.names + off) & (newCapacity - 1);
+            while (table[h] >= 0) h = (h + 1) & (newCapacity - 1);
+            table[h] = off;
+        }
+        free(store.internTable);
+        store.internTable = table;
+        store.internCapacity = newCapacity;
+    }
+
+    unsigned long h = hashName(name) & (store.internCapacity - 1);
+    while (store.internTable[h] >= 0) {
+        if (strcmp(store.names + store.internTable[h], name) == 0) return store.internTable[h];
+        h = (h + 1) & (store.internCapacity - 1);
+    }
+
+    long len = (long)strlen(name) + 1;
+    if (store.namesUsed + len > store.namesCapacity) {
+        long newCapacity = store.namesCapacity ? store.namesCapacity * 2 : 4096;
+        while (store.namesUsed + len > newCapacity) newCapacity *= 2;
+        char *bigger = realloc(store.names, newCapacity);
+        if (!bigger) return -1;
+        store.names = bigger;
+        store.namesCapacity = newCapacity;
+    }
+
+    long off = store.namesUsed;
+    memcpy(store.names + off, name, len);
+    store.namesUsed += len;
+    store.internTable[h] = off;
+    store.internCount++;
+    return off;
+}
+
+// Add a record as the last row of the store; returns 0 if out of memory
+int storeAppend(const struct Student *s) {
+    char firstName[sizeof(s->firstName)], lastName[sizeof(s->lastName)];
+
+    if (store.count == store.capacity) {
+        long newCapacity = store.capacity ? store.capacity * 2 : 256;
+        char (*rolls)[ROLL_LEN] = realloc(store.rolls, newCapacity * sizeof(*rolls));
+        if (rolls) store.rolls = rolls;
+        long *firstNames = realloc(store.firstNames, newCapacity * sizeof(long));
+        if (firstNames) store.firstNames = firstNames;
+        long *lastNames = realloc(store.lastNames, newCapacity * sizeof(long));
+        if (lastNames) store.lastNames = lastNames;
+        if (!rolls || !firstNames || !lastNames) return 0;
+        store.capacity = newCapacity;
+    }
+
+    // Fields read from the file are not trusted to be terminated
+    memcpy(firstName, s->firstName, sizeof(firstName));
+    firstName[sizeof(firstName) - 1] = '\0';
+    memcpy(lastName, s->lastName, sizeof(lastName));
+    lastName[sizeof(lastName) - 1] = '\0';
+
+    // Tombstones keep no names
+    long firstOff = internName(s->roll[0] ? firstName : "");
+    long lastOff = internName(s->roll[0] ? lastName : "");
+    if (firstOff < 0 || lastOff < 0) return 0;
+
+    long row = store.count;
+    memcpy(store.rolls[row], s->roll, ROLL_LEN - 1);
+    store.rolls[row][ROLL_LEN - 1] = '\0';
+    store.firstNames[row] = firstOff;
+    store.lastNames[row] = lastOff;
+    store.count++;
+    return 1;
+}
+
+int rowAlive(long row) { return store.rolls[row][0] != '\0'; }
+const char *rowRoll(long row) { return store.rolls[row]; }
+const char *rowFirstName(long row) { return store.names + store.firstNames[row]; }
+const char *rowLastName(long row) { return store.names + store.lastNames[row]; }
+
+// Rebuild the on-disk record of a row
+void rowToStudent(long row, struct Student *s) {
+    memset(s, 0, sizeof(*s));
+    strcpy(s->firstName, rowFirstName(row));
+    strcpy(s->lastName, rowLastName(row));
+    strcpy(s->roll, rowRoll(row));
+}
+
+// Compare at most n characters ignoring case (n = (size_t)-1 for whole strings)
+int compareNoCase(const char *a, const char *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int ca = tolower((unsigned char)a[i]), cb = tolower((unsigned char)b[i]);
+        if (ca != cb) return ca - cb;
+        if (ca == '\0') return 0;
+    }
+    return 0;
+}
+
+// Order of the name index: last name ignoring case, then row
+static int compareEntry(long a, long b) {
+    int c = compareNoCase(rowLastName(a), rowLastName(b), (size_t)-1);
+    if (c != 0) return c;
+    return (a > b) - (a < b);
+}
+
+// Position in the name index of the first row whose name is >= key (ignoring case)
+long findNameStart(const char *key) {
+    long lo = 0, hi = nameCount;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (compareNoCase(rowLastName(nameIndex[mid]), key, (size_t)-1) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Position of row in the name index, or where it would be inserted
+static long findNameEntry(long row) {
+    long lo = 0, hi = nameCount;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (compareEntry(nameIndex[mid], row) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Make room for one more row in the name index; returns 0 if out of memory
+int growNameIndex() {
+    if (nameCount == nameCapacity) {
+        long newCapacity = nameCapacity ? nameCapacity * 2 : 64;
+        long *bigger = realloc(nameIndex, newCapacity * sizeof(long));
+        if (!bigger) return 0;
+        nameIndex = bigger;
+        nameCapacity = newCapacity;
+    }
+    return 1;
+}
+
+static int compareRows(const void *a, const void *b) {
+    return compareEntry(*(const long *)a, *(const long *)b);
+}
+
+// Sort the whole name index at once (used after loading, instead of one insert per record)
+void sortNameIndex() {
+    if (nameCount > 1) qsort(nameIndex, nameCount, sizeof(long), compareRows);
+}
+
+// Insert a row in sorted position; returns 0 if out of memory.
+// Students are added as the last row, so the new row goes after every row with
+// an equal name and this is the same as an append for them.
+int addNameEntry(long row) {
+    if (!growNameIndex()) return 0;
+
+    long at = findNameEntry(row);
+    memmove(&nameIndex[at + 1], &nameIndex[at], (nameCount - at) * sizeof(long));
+    nameIndex[at] = row;
+    nameCount++;
+    return 1;
+}
+
+// Remove a row from the name index (call before the row leaves the store)
+void removeNameEntry(long row) {
+    long at = findNameEntry(row);
+    if (at < nameCount && nameIndex[at] == row) {
+        memmove(&nameIndex[at], &nameIndex[at + 1], (nameCount - at - 1) * sizeof(long));
+        nameCount--;
+    }
+}
+
 // Add a new student to the file
 void addStudent() {
     struct Student s;
 
     // Input
+    memset(&s, 0, sizeof(s));
+
     printf("Enter First Name: ");
-    scanf("%s", s.firstName);
+    scanf("%49s", s.firstName);
 
     printf("Enter Last Name: ");
-    scanf("%s", s.lastName);
+    scanf("%49s", s.lastName);
 
     printf("Enter Roll Number (e.g., AM12345): ");
-    scanf("%s", s.roll);
+    scanf("%9s", s.roll);
 
     // Validate roll number format
     if (!isValidRoll(s.roll)) {
@@ -114,49 +580,78 @@ void addStudent() {
         return;
     }
 
-    // Check for duplicate roll number in file
-    FILE *fp = fopen(FILE_NAME, "rb");
-    if (fp) {
-        struct Student temp;
-        while (fread(&temp, sizeof(temp), 1, fp)) {
-            if (strcmp(temp.roll, s.roll) == 0) {
-                printf(" Student with roll number %s already exists. Cannot add duplicate.\n", s.roll);
-                fclose(fp);
-                return;
-            }
-        }
-        fclose(fp);
-    }
-
-    // Add to memory
-    if (studentCount < MAX_STUDENTS) {
-        students[studentCount++] = s;
-    } else {
-        printf(" Maximum number of students reached in memory.\n");
+    // Check for duplicate roll number in the index
+    int slot = rollSlot(s.roll);
+    if (rollIndex[slot] >= 0) {
+        printf(" Student with roll number %s already exists. Cannot add duplicate.\n", s.roll);
         return;
     }
 
-    // Save to file
-    fp = fopen(FILE_NAME, "ab");
-    if (!fp) {
-        printf("Error opening file!\n");
-        return;
-    }
-
-    fwrite(&s, sizeof(s), 1, fp);
-    fclose(fp);
+    if (!insertStudent(&s)) return;
 
     printf(" Student added successfully!\n");
 }
 
+// Checkpoint once enough changes have been journaled
+static void changeMade() {
+    if (recStoreDue(&db)) checkpointStudents();
+}
+
+// Add a new student to memory and both indexes; returns 0 if out of memory
+static int addRow(const struct Student *s) {
+    long row = store.count;
+
+    if (!storeAppend(s)) return 0;
+    rollIndex[rollSlot(s->roll)] = row;
+    addNameEntry(row);
+    return 1;  // The new row is appended to students.dat at the next checkpoint
+}
+
+// Turn the row of a used roll index slot into a tombstone
+static int deleteRow(int slot) {
+    long target = rollIndex[slot];
+
+    removeNameEntry(target);
+    rollIndex[slot] = -1;
+    store.rolls[target][0] = '\0';
+    store.deadCount++;
+    recStoreMarkDirty(&db, target);  // Zeroed in place at the next checkpoint
+    return 1;
+}
+
+// Journal a valid, new student and add it; returns 1 on success.
+// The journal entry is the commit: students.dat catches up at the next checkpoint.
+int insertStudent(const struct Student *s) {
+    int result = recStoreChange(&db, OP_ADD, s, sizeof(*s));
+
+    if (result == RECSTORE_JOURNAL_FAILED) {
+        fprintf(stderr, " Error writing the journal! Student not added.\n");
+        return 0;
+    }
+    if (!result) {
+        fprintf(stderr, " Out of memory. Student not added.\n");
+        return 0;
+    }
+    changeMade();
+    return 1;
+}
+
+// Journal the deletion of the student in a used roll index slot and make it; returns 1 on success
+int removeStudent(int slot) {
+    if (recStoreChange(&db, OP_DELETE, rowRoll(rollIndex[slot]), ROLL_LEN) == RECSTORE_JOURNAL_FAILED) {
+        fprintf(stderr, " Error writing the journal! Student not deleted.\n");
+        return 0;
+    }
+    changeMade();
+    return 1;
+}
+
 
-// Display all student records from the file
+// Display all student records
 void displayStudents() {
-    struct Student s;
-    FILE *fp = fopen(FILE_NAME, "rb");
-    int count = 1;
+    long count = 1;
 
-    if (!fp) {
+    if (store.count == store.deadCount) {
         printf("No records found.\n");
         return;
     }
@@ -164,16 +659,37 @@ void displayStudents() {
     printf("\n%-5s %-18s %-18s %-15s\n", "No", "First Name", "Last Name", "Roll");
     printf("---------------------------------------------------------------\n");
 
-    while (fread(&s, sizeof(s), 1, fp)) {
-        printf("%-5d %-20s %-20s %-10s\n", count++, s.firstName, s.lastName, s.roll);
+    for (long row = 0; row < store.count; row++) {
+        if (!rowAlive(row)) continue;
+        printf("%-5ld %-20s %-20s %-10s\n", count++, rowFirstName(row), rowLastName(row), rowRoll(row));
     }
+}
 
-    fclose(fp);
+// Does a row match the searched last name in the given mode?
+static int nameMatches(long row, const char *lastName, int mode) {
+    if (mode == MATCH_PREFIX) return compareNoCase(rowLastName(row), lastName, strlen(lastName)) == 0;
+    if (mode == MATCH_IGNORE_CASE) return compareNoCase(rowLastName(row), lastName, (size_t)-1) == 0;
+    return strcmp(rowLastName(row), lastName) == 0;
+}
+
+// Position >= i in the name index of the next row matching key in mode, or -1.
+// All candidates are a contiguous run of the index, so start at findNameStart(key).
+long nextNameMatch(long i, const char *key, int mode) {
+    for (; i < nameCount; i++) {
+        long row = nameIndex[i];
+        if (mode == MATCH_PREFIX) {
+            if (!nameMatches(row, key, mode)) return -1;
+        } else {
+            if (compareNoCase(rowLastName(row), key, (size_t)-1) != 0) return -1;
+            if (!nameMatches(row, key, mode)) continue;
+        }
+        return i;
+    }
+    return -1;
 }
 
 // Search student by roll number or last name
 void searchStudent() {
-    struct Student s;
     int choice;
     int attempts = 0;
     int found = 0;
@@ -187,27 +703,25 @@ void searchStudent() {
     if (choice == 1) {
         char roll[10];
         while (attempts < 3 && !found) {
-            FILE *fp = fopen(FILE_NAME, "rb");
-            if (!fp) {
+            if (store.count == store.deadCount) {
                 printf("No records found.\n");
                 return;
             }
 
             printf("Enter roll number: ");
-            scanf("%s", roll);
-
-            while (fread(&s, sizeof(s), 1, fp)) {
-                if (strcmp(s.roll, roll) == 0) {
-                    printf("\n Student found:\n");
-                    printf("First Name: %s\n", s.firstName);
-                    printf("Last Name: %s\n", s.lastName);
-                    printf("Roll Number: %s\n", s.roll);
-                    found = 1;
-                    break;
-                }
+            scanf("%9s", roll);
+
+            // Look the roll number up in the index
+            int slot = rollSlot(roll);
+            if (slot >= 0 && rollIndex[slot] >= 0) {
+                long row = rollIndex[slot];
+                printf("\n Student found:\n");
+                printf("First Name: %s\n", rowFirstName(row));
+                printf("Last Name: %s\n", rowLastName(row));
+                printf("Roll Number: %s\n", rowRoll(row));
+                found = 1;
             }
 
-            fclose(fp);
             if (!found) {
                 attempts++;
                 if (attempts < 3)
@@ -217,31 +731,43 @@ void searchStudent() {
 
     } else if (choice == 2) {
         char lastName[50];
+        int mode;
+
+        printf("Match:\n");
+        printf("1. Exact\n");
+        printf("2. Exact, ignoring case\n");
+        printf("3. Starts with (ignoring case)\n");
+        printf("Enter choice (1-3): ");
+        scanf("%d", &mode);
+        if (mode < MATCH_EXACT || mode > MATCH_PREFIX) {
+            printf(" Invalid choice.\n");
+            return;
+        }
+
         while (attempts < 3 && !found) {
-            FILE *fp = fopen(FILE_NAME, "rb");
-            if (!fp) {
+            if (store.count == store.deadCount) {
                 printf("No records found.\n");
                 return;
             }
 
-            printf("Enter last name: ");
-            scanf("%s", lastName);
+            printf(mode == MATCH_PREFIX ? "Enter start of last name: " : "Enter last name: ");
+            scanf("%49s", lastName);
 
             int matchCount = 0;
-            while (fread(&s, sizeof(s), 1, fp)) {
-                if (strcmp(s.lastName, lastName) == 0) {
-                    if (matchCount == 0)
-                        printf("\n Students with last name \"%s\":\n", lastName);
-                    printf("--------------------------\n");
-                    printf("First Name: %s\n", s.firstName);
-                    printf("Last Name: %s\n", s.lastName);
-                    printf("Roll Number: %s\n", s.roll);
-                    matchCount++;
-                    found = 1;
-                }
-            }
+            for (long i = nextNameMatch(findNameStart(lastName), lastName, mode); i >= 0;
+                 i = nextNameMatch(i + 1, lastName, mode)) {
+                long row = nameIndex[i];
 
-            fclose(fp);
+                if (matchCount == 0)
+                    printf(mode == MATCH_PREFIX ? "\n Students with last name starting with \"%s\":\n"
+                                                : "\n Students with last name \"%s\":\n", lastName);
+                printf("--------------------------\n");
+                printf("First Name: %s\n", rowFirstName(row));
+                printf("Last Name: %s\n", rowLastName(row));
+                printf("Roll Number: %s\n", rowRoll(row));
+                matchCount++;
+                found = 1;
+            }
 
             if (!found) {
                 attempts++;
@@ -259,63 +785,566 @@ void searchStudent() {
         printf(" No student found after 3 attempts. Returning to main menu...\n");
 }
 
-// Delete a student by roll number
+// Delete a student by roll number: the record is overwritten in place with a tombstone
 void deleteStudent() {
-    struct Student s;
     char roll[20];
-    int found = 0;
 
-    FILE *fp = fopen(FILE_NAME, "rb");
-    FILE *temp = fopen("temp.dat", "wb");
+    printf("Enter roll number to delete: ");
+    scanf("%19s", roll);
 
-    if (!fp || !temp) {
-        printf("Error opening file!\n");
+    // Unknown roll numbers are answered from the index without touching the file
+    int slot = rollSlot(roll);
+    if (slot < 0 || rollIndex[slot] < 0) {
+        printf("Student with roll number %s not found.\n", roll);
         return;
     }
 
-    printf("Enter roll number to delete: ");
-    scanf("%s", roll);
+    if (!removeStudent(slot)) return;
 
-    while (fread(&s, sizeof(s), 1, fp)) {
-        if (strcmp(s.roll, roll) == 0) {
-            found = 1;
-            continue;
+    printf(" Student record deleted successfully!\n");
+
+    if (store.deadCount >= COMPACT_MIN_DEAD && store.deadCount * COMPACT_RATIO > store.count)
+        compactStudents();
+}
+
+// Compact students.dat if it has any tombstones; returns 1 on success
+int compactStudents() {
+    return store.deadCount == 0 || rewriteStudents();
+}
+
+// Make students.dat hold every journaled change, then empty the journal; returns 1 on success.
+// Only the changed records are written, unless the file has to be rewritten.
+int checkpointStudents() {
+    if (recStoreCheckpoint(&db)) return 1;
+    fprintf(stderr, " Error writing %s! Changes are kept in the journal.\n", FILE_NAME);
+    return 0;
+}
+
+// Drop the tombstones and renumber the rows, then write students.dat again from
+// memory; returns 1 on success. The new file holds every journaled change, so this
+// is also a checkpoint (if it fails, the next checkpoint tries the rewrite again).
+int rewriteStudents() {
+    // newRow[old row] = row after compaction
+    long *newRow = malloc((store.count ? store.count : 1) * sizeof(long));
+    if (!newRow) {
+        fprintf(stderr, " Out of memory. The data file was not compacted.\n");
+        return 0;
+    }
+
+    long live = 0;
+    for (long row = 0; row < store.count; row++) {
+        if (rowAlive(row)) newRow[row] = live++;
+    }
+
+    // Renumber the indexes, then close the gaps in the columns.
+    // Compaction keeps the order of the rows, so the name index stays sorted.
+    for (int i = 0; i < ROLL_SLOTS; i++) {
+        if (rollIndex[i] >= 0) rollIndex[i] = newRow[rollIndex[i]];
+    }
+    for (long i = 0; i < nameCount; i++) {
+        nameIndex[i] = newRow[nameIndex[i]];
+    }
+    for (long row = 0; row < store.count; row++) {
+        if (!rowAlive(row)) continue;
+        long to = newRow[row];
+        memcpy(store.rolls[to], store.rolls[row], ROLL_LEN);
+        store.firstNames[to] = store.firstNames[row];
+        store.lastNames[to] = store.lastNames[row];
+    }
+    store.count = live;
+    store.deadCount = 0;
+    free(newRow);
+
+    db.rewrite = 1;  // Every row has moved
+    return checkpointStudents();
+}
+
+// Output buffer of the exporter: fields are copied in with memcpy and the
+// buffer goes out with one fwrite whenever it fills up
+struct OutBuffer {
+    FILE *fp;
+    char *data;
+    size_t used;
+    int failed;
+};
+
+static void outFlush(struct OutBuffer *out) {
+    if (out->used > 0 && fwrite(out->data, 1, out->used, out->fp) != out->used) out->failed = 1;
+    out->used = 0;
+}
+
+static void outWrite(struct OutBuffer *out, const char *src, size_t len) {
+    if (out->used + len > EXPORT_BUFFER) {
+        outFlush(out);
+        if (len > EXPORT_BUFFER) {  // Never for a single field, but stay correct
+            if (fwrite(src, 1, len, out->fp) != len) out->failed = 1;
+            return;
         }
-        fwrite(&s, sizeof(s), 1, temp);
     }
+    memcpy(out->data + out->used, src, len);
+    out->used += len;
+}
 
-    fclose(fp);
-    fclose(temp);
+static void outString(struct OutBuffer *out, const char *s) {
+    outWrite(out, s, strlen(s));
+}
 
-    remove(FILE_NAME);
-    rename("temp.dat", FILE_NAME);
+// A JSON string value, with quotes, backslashes and control characters escaped
+static void outJSONString(struct OutBuffer *out, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    const char *run = s;
 
-    if (found)
-        printf(" Student record deleted successfully!\n");
-    else
-        printf("Student with roll number %s not found.\n", roll);
+    outWrite(out, "\"", 1);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+        outWrite(out, run, s - run);
+        if (c == '"') outWrite(out, "\\\"", 2);
+        else if (c == '\\') outWrite(out, "\\\\", 2);
+        else {
+            char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            outWrite(out, escape, 6);
+        }
+        run = s + 1;
+    }
+    outWrite(out, run, s - run);
+    outWrite(out, "\"", 1);
 }
 
-// Export all student records to a CSV file
-void exportToCSV() {
-    struct Student s;
-    FILE *fp = fopen(FILE_NAME, "rb");
-    FILE *csv = fopen("students_export.csv", "w");
+// A CSV field, quoted (with quotes doubled) if it holds a comma, a quote or a line break (RFC 4180)
+static void outCSVField(struct OutBuffer *out, const char *s) {
+    if (!strpbrk(s, ",\"\r\n")) {
+        outString(out, s);
+        return;
+    }
+
+    outWrite(out, "\"", 1);
+    for (const char *quote; (quote = strchr(s, '"')); s = quote + 1) {
+        outWrite(out, s, quote - s + 1);
+        outWrite(out, "\"", 1);
+    }
+    outString(out, s);
+    outWrite(out, "\"", 1);
+}
+
+// Write every student to out in the given format; returns the number written, or -1 on error
+long writeExport(FILE *out, int format) {
+    struct OutBuffer buf = {out, malloc(EXPORT_BUFFER), 0, 0};
+    long written = 0;
+
+    if (!buf.data) return -1;
+
+    if (format == EXPORT_CSV) outString(&buf, "Roll,First Name,Last Name\n");  // Header
+
+    for (long row = 0; row < store.count; row++) {
+        if (!rowAlive(row)) continue;
+        if (format == EXPORT_CSV) {
+            outCSVField(&buf, rowRoll(row));
+            outWrite(&buf, ",", 1);
+            outCSVField(&buf, rowFirstName(row));
+            outWrite(&buf, ",", 1);
+            outCSVField(&buf, rowLastName(row));
+            outWrite(&buf, "\n", 1);
+        } else {
+            outString(&buf, "{\"roll\":");
+            outJSONString(&buf, rowRoll(row));
+            outString(&buf, ",\"firstName\":");
+            outJSONString(&buf, rowFirstName(row));
+            outString(&buf, ",\"lastName\":");
+            outJSONString(&buf, rowLastName(row));
+            outString(&buf, "}\n");
+        }
+        written++;
+    }
+
+    outFlush(&buf);
+    if (fflush(out) != 0) buf.failed = 1;
+    free(buf.data);
+    return buf.failed ? -1 : written;
+}
 
-    if (!fp || !csv) {
+// Export all student records to a CSV or JSON Lines file, or to stdout ("-")
+void exportStudents() {
+    char path[256];
+    int format;
+
+    printf("Format:\n");
+    printf("1. CSV\n");
+    printf("2. JSON Lines\n");
+    printf("Enter choice (1 or 2): ");
+    scanf("%d", &format);
+    if (format != EXPORT_CSV && format != EXPORT_JSONL) {
+        printf(" Invalid choice.\n");
+        return;
+    }
+
+    printf("Enter output file (- for stdout): ");
+    scanf("%255s", path);
+
+    int toStdout = strcmp(path, "-") == 0;
+    FILE *out = toStdout ? stdout : fopen(path, "w");
+    if (!out) {
         printf(" Error opening file(s) for export.\n");
         return;
     }
-    // CSV header
-    fprintf(csv, "Roll,First Name,Last Name\n");  // Header
 
-    // Write each student record to CSV
-    while (fread(&s, sizeof(s), 1, fp)) {
-        fprintf(csv, "%s,%s,%s\n", s.roll, s.firstName, s.lastName);
+    long written = writeExport(out, format);
+    if (!toStdout && fclose(out) != 0) written = -1;
+
+    if (written < 0) printf(" Error writing the export.\n");
+    else printf(" Exported %ld students successfully to %s\n", written, toStdout ? "stdout" : path);
+}
+
+// Copy one CSV field into dest (of size destSize); returns 0 if it is empty or too long
+static int copyField(char *dest, size_t destSize, const char *field) {
+    size_t len = strlen(field);
+    if (len == 0 || len >= destSize) return 0;
+    memcpy(dest, field, len + 1);
+    return 1;
+}
+
+// Cut the next field off the CSV line at *cursor, unquoting it in place (RFC 4180);
+// *cursor moves past its comma, or becomes NULL after the last field. Returns NULL if
+// a quoted field is not closed properly.
+static char *nextCSVField(char **cursor) {
+    char *field = *cursor, *in = field, *out = field;
+
+    if (*in == '"') {
+        for (in++; *in != '"' || in[1] == '"'; in++) {
+            if (*in == '\0') return NULL;
+            if (*in == '"') in++;  // A doubled quote stands for one
+            *out++ = *in;
+        }
+        in++;
+        if (*in != ',' && *in != '\0') return NULL;
+    } else {
+        in += strcspn(in, ",");
+        out = in;
     }
 
-    fclose(fp);
+    *cursor = *in == ',' ? in + 1 : NULL;
+    *out = '\0';
+    return field;
+}
+
+// Split a CSV line into a student record; returns NULL if it is valid, otherwise the reason
+static const char *parseCSVRow(char *line, struct Student *s) {
+    char *fields[3], *cursor = line;
+    int count = 0;
+
+    while (cursor) {
+        if (count == 3) return "too many fields";
+        fields[count] = nextCSVField(&cursor);
+        if (!fields[count++]) return "badly quoted field";
+    }
+    if (count < 3) return "expected Roll,First Name,Last Name";
+
+    memset(s, 0, sizeof(*s));
+    if (!isValidRoll(fields[0])) return "invalid roll number (expected AM followed by 5 digits)";
+    strcpy(s->roll, fields[0]);
+    if (!copyField(s->firstName, sizeof(s->firstName), fields[1])) return "first name is empty or too long";
+    if (!copyField(s->lastName, sizeof(s->lastName), fields[2])) return "last name is empty or too long";
+    return NULL;
+}
+
+// Import students from a CSV file (menu option)
+void importFromCSV() {
+    char path[256];
+    long rejected;
+
+    printf("Enter CSV file to import: ");
+    scanf("%255s", path);
+
+    long added = importCSV(path, &rejected);
+    if (added < 0) printf(" Could not open %s.\n", path);
+    else printf(" Imported %ld students, rejected %ld rows.\n", added, rejected);
+}
+
+// Import students from a CSV file in the layout written by the CSV export.
+// Rows are checked as they are read; all accepted rows are appended with one write.
+// Returns the number of students added (-1 if the file cannot be opened).
+long importCSV(const char *path, long *rejectedOut) {
+    struct Student s;
+    char line[CSV_LINE];
+    long lineNo = 0, rejected = 0;
+    long first = store.count;  // Row of the first imported student
+
+    *rejectedOut = 0;
+    FILE *csv = fopen(path, "r");
+    if (!csv) return -1;
+
+    while (fgets(line, sizeof(line), csv)) {
+        const char *reason = NULL;
+        lineNo++;
+
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(csv)) {
+            int c;
+            while ((c = fgetc(csv)) != EOF && c != '\n') {}  // Skip the rest of the line
+            reason = "line too long";
+        } else {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '\0') continue;
+            if (lineNo == 1 && strcmp(line, "Roll,First Name,Last Name") == 0) continue;  // Header
+            reason = parseCSVRow(line, &s);
+        }
+
+        // Duplicates of existing students and of earlier rows of this file
+        int slot = reason ? -1 : rollSlot(s.roll);
+        if (!reason && rollIndex[slot] >= 0) reason = "duplicate roll number";
+        if (!reason && !storeAppend(&s)) reason = "out of memory";
+
+        if (reason) {
+            fprintf(stderr, " Line %ld rejected: %s\n", lineNo, reason);
+            rejected++;
+            continue;
+        }
+        rollIndex[slot] = store.count - 1;
+    }
     fclose(csv);
 
-    printf(" Exported successfully to students_export.csv\n");
+    // Journal every accepted row with one sync at the end (group commit)
+    long added = store.count - first;
+    long logged = 0;
+    struct Student *records = added > 0 ? malloc(added * sizeof(struct Student)) : NULL;
+    if (added > 0 && records) {
+        journalBeginBatch(&db.journal);
+        while (logged < added) {
+            rowToStudent(first + logged, &records[logged]);
+            if (!recStoreLog(&db, OP_ADD, &records[logged], sizeof(struct Student))) break;
+            logged++;
+        }
+        if (!journalEndBatch(&db.journal)) fprintf(stderr, " Warning: the journal could not be synced to disk.\n");
+    }
+
+    // Rows that did not make it into the journal are not imported
+    if (logged < added) {
+        for (long row = first + logged; row < store.count; row++) rollIndex[rollSlot(rowRoll(row))] = -1;
+        store.count = first + logged;
+        fprintf(stderr, " Error writing the journal! Only %ld of %ld students were imported.\n", logged, added);
+        rejected += added - logged;
+        added = logged;
+    }
+
+    // They are appended to students.dat in one go at the next checkpoint
+    if (added > 0) {
+        for (long row = first; row < store.count; row++) {
+            if (growNameIndex()) nameIndex[nameCount++] = row;
+        }
+        sortNameIndex();
+        changeMade();
+    }
+    free(records);
+
+    *rejectedOut = rejected;
+    return added;
+}
+
+// ---------- Command line ----------
+
+void usage() {
+    fprintf(stderr,
+            "Usage: student_records                        interactive menu\n"
+            "       student_records add ROLL FIRST LAST\n"
+            "       student_records get ROLL\n"
+            "       student_records delete ROLL\n"
+            "       student_records search LAST [--ignore-case | --prefix]\n"
+            "       student_records import FILE.csv\n"
+            "       student_records export [--json] [FILE | -]\n"
+            "       student_records batch [FILE | -]\n"
+            "\n"
+            "get and search print Roll,First Name,Last Name lines on stdout, quoted like\n"
+            "the CSV export.\n"
+            "A batch file has one command per line (add, get, delete, search;\n"
+            "search takes exact, nocase or prefix as its last word). Lines starting\n"
+            "with # are skipped. All its changes are journaled with one sync.\n");
+}
+
+// A field of printRow, quoted like outCSVField
+static void printCSVField(const char *s) {
+    if (!strpbrk(s, ",\"\r\n")) {
+        fputs(s, stdout);
+        return;
+    }
+
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"') putchar('"');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+static void printRow(long row) {
+    printCSVField(rowRoll(row));
+    putchar(',');
+    printCSVField(rowFirstName(row));
+    putchar(',');
+    printCSVField(rowLastName(row));
+    putchar('\n');
+}
+
+// The operations shared by the single commands and batch files.
+// Each returns NULL on success or the reason it failed.
+
+static const char *opAdd(const char *roll, const char *firstName, const char *lastName) {
+    struct Student s;
+
+    if (!isValidRoll(roll)) return "invalid roll number (expected AM followed by 5 digits)";
+    if (strlen(firstName) >= sizeof(s.firstName) || strlen(lastName) >= sizeof(s.lastName))
+        return "name too long";
+    if (strpbrk(firstName, "\r\n") || strpbrk(lastName, "\r\n")) return "name contains a line break";  // One CSV line per student
+    if (rollIndex[rollSlot(roll)] >= 0) return "duplicate roll number";
+
+    memset(&s, 0, sizeof(s));
+    strcpy(s.roll, roll);
+    strcpy(s.firstName, firstName);
+    strcpy(s.lastName, lastName);
+    return insertStudent(&s) ? NULL : "could not be saved";
+}
+
+static const char *opGet(const char *roll) {
+    int slot = rollSlot(roll);
+    if (slot < 0 || rollIndex[slot] < 0) return "not found";
+    printRow(rollIndex[slot]);
+    return NULL;
+}
+
+static const char *opDelete(const char *roll) {
+    int slot = rollSlot(roll);
+    if (slot < 0 || rollIndex[slot] < 0) return "not found";
+    if (!removeStudent(slot)) return "could not be saved";
+    if (store.deadCount >= COMPACT_MIN_DEAD && store.deadCount * COMPACT_RATIO > store.count)
+        compactStudents();
+    return NULL;
+}
+
+static const char *opSearch(const char *lastName, int mode) {
+    long found = 0;
+    for (long i = nextNameMatch(findNameStart(lastName), lastName, mode); i >= 0;
+         i = nextNameMatch(i + 1, lastName, mode)) {
+        printRow(nameIndex[i]);
+        found++;
+    }
+    return found ? NULL : "no match";
+}
+
+// Search mode from an option ("--prefix") or batch word ("prefix"); 0 if unknown
+static int searchMode(const char *word) {
+    while (*word == '-') word++;
+    if (strcmp(word, "exact") == 0) return MATCH_EXACT;
+    if (strcmp(word, "ignore-case") == 0 || strcmp(word, "nocase") == 0) return MATCH_IGNORE_CASE;
+    if (strcmp(word, "prefix") == 0) return MATCH_PREFIX;
+    return 0;
+}
+
+// Run the commands of a batch file (or stdin for "-"); returns the exit status
+static int runBatch(const char *path) {
+    char line[CSV_LINE];
+    char cmd[16], a[64], b[64], c[64];
+    long lineNo = 0, failed = 0;
+
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Could not open %s.\n", path);
+        return EXIT_USAGE;
+    }
+
+    journalBeginBatch(&db.journal);
+    while (fgets(line, sizeof(line), in)) {
+        const char *reason;
+        lineNo++;
+
+        int words = sscanf(line, "%15s %63s %63s %63s", cmd, a, b, c);
+        if (words <= 0 || cmd[0] == '#') continue;
+
+        if (strcmp(cmd, "add") == 0 && words == 4) reason = opAdd(a, b, c);
+        else if (strcmp(cmd, "get") == 0 && words == 2) reason = opGet(a);
+        else if (strcmp(cmd, "delete") == 0 && words == 2) reason = opDelete(a);
+        else if (strcmp(cmd, "search") == 0 && words == 2) reason = opSearch(a, MATCH_EXACT);
+        else if (strcmp(cmd, "search") == 0 && words == 3 && searchMode(b)) reason = opSearch(a, searchMode(b));
+        else reason = "unknown command or wrong number of arguments";
+
+        if (reason) {
+            fprintf(stderr, "Line %ld: %s: %s\n", lineNo, cmd, reason);
+            failed++;
+        }
+    }
+    if (!journalEndBatch(&db.journal)) fprintf(stderr, "Warning: the journal could not be synced to disk.\n");
+
+    if (in != stdin) fclose(in);
+    return failed ? EXIT_FAILED : EXIT_OK;
+}
+
+// Commands that only read: they load students.dat without ever writing it
+int readOnlyCommand(const char *cmd) {
+    return strcmp(cmd, "get") == 0 || strcmp(cmd, "search") == 0 || strcmp(cmd, "export") == 0 ||
+           strcmp(cmd, "--help") == 0;
+}
+
+// Run one non-interactive command on the loaded store, then checkpoint; returns the exit status
+int runCommand(int argc, char *argv[]) {
+    const char *cmd = argv[1];
+    const char *reason = NULL;
+    int status = EXIT_OK;
+
+    if (strcmp(cmd, "add") == 0 && argc == 5) {
+        reason = opAdd(argv[2], argv[3], argv[4]);
+    } else if (strcmp(cmd, "get") == 0 && argc == 3) {
+        reason = opGet(argv[2]);
+    } else if (strcmp(cmd, "delete") == 0 && argc == 3) {
+        reason = opDelete(argv[2]);
+    } else if (strcmp(cmd, "search") == 0 && (argc == 3 || (argc == 4 && searchMode(argv[3])))) {
+        reason = opSearch(argv[2], argc == 4 ? searchMode(argv[3]) : MATCH_EXACT);
+    } else if (strcmp(cmd, "import") == 0 && argc == 3) {
+        long rejected;
+        long added = importCSV(argv[2], &rejected);
+        if (added < 0) {
+            fprintf(stderr, "Could not open %s.\n", argv[2]);
+            status = EXIT_USAGE;
+        } else {
+            fprintf(stderr, "Imported %ld students, rejected %ld rows.\n", added, rejected);
+            if (rejected > 0) status = EXIT_FAILED;
+        }
+    } else if (strcmp(cmd, "export") == 0 && argc <= 4) {
+        int json = argc >= 3 && strcmp(argv[2], "--json") == 0;
+        const char *path = argc > 2 + json ? argv[2 + json] : "-";
+        if (argc == 4 && !json) {
+            usage();
+            return EXIT_USAGE;
+        }
+
+        FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+        if (!out) {
+            fprintf(stderr, "Could not open %s.\n", path);
+            return EXIT_USAGE;
+        }
+        long written = writeExport(out, json ? EXPORT_JSONL : EXPORT_CSV);
+        if (out != stdout && fclose(out) != 0) written = -1;
+        if (written < 0) {
+            fprintf(stderr, "Error writing the export.\n");
+            status = EXIT_STORAGE;
+        }
+    } else if (strcmp(cmd, "batch") == 0 && argc <= 3) {
+        status = runBatch(argc == 3 ? argv[2] : "-");
+    } else {
+        usage();
+        return strcmp(cmd, "--help") == 0 ? EXIT_OK : EXIT_USAGE;
+    }
+
+    if (reason) {
+        fprintf(stderr, "%s: %s\n", cmd, reason);
+        status = EXIT_FAILED;
+    }
+
+    // Records lost to a damaged students.dat are missing from whatever the command did,
+    // so a script must not take it for a complete result
+    int damaged = db.loadStatus == RECFILE_CORRUPT || db.loadStatus == RECFILE_BAD_HEADER;
+    if (damaged && status == EXIT_OK) status = EXIT_STORAGE;
+
+    // Save the changes into students.dat before exiting
+    if (!checkpointStudents() && status == EXIT_OK) status = EXIT_STORAGE;
+    recStoreClose(&db);
+    if (fflush(stdout) != 0 && status == EXIT_OK) status = EXIT_STORAGE;
+    return status;
 }
@@ -0,0 +1,299 @@
+/*
+==============================================
+   Student Record System Benchmark - C
+==============================================
+
+Generates a synthetic students.dat and times the operations of
+student_records.c on it, through the same functions the menu and the
+commands use:
+- generate (RecWriter) and load (loadStudents: mapping, name pool, indexes)
+- add with the duplicate check, and rejected duplicates
+- get by roll number, search by last name (exact and prefix)
+- delete, then the checkpoint that writes the deleted records in place
+- export to CSV and JSON Lines, and the compaction rewrite
+
+For the repeated operations it reports p50 / p90 / p99 / max latency and
+operations per second; at the end the record store counters (checkpoints,
+full rewrites, records written) and the peak memory.
+
+Roll numbers are AM00000..AM99999, so a dataset has at most 100000
+students (minus the ones the add benchmark needs).
+
+Every file is created in a working directory of its own (bench_data by
+default), so a real students.dat is never touched. The journal is synced
+on every change as in the real program, so the add and delete latencies
+include the fsync.
+
+Usage:
+-----------------------------------
+gcc -O2 -o student_records_bench student_records_bench.c ../../Common/code/recfile.c ../../Common/code/journal.c ../../Common/code/recstore.c ../../Common/code/bench.c
+(on Windows add -lpsapi)
+./student_records_bench                    90000 students, 1000 operations of each kind
+./student_records_bench --records 10000    dataset size
+./student_records_bench --ops 5000         operations of each kind
+./student_records_bench --json             one JSON object per line, for tracking regressions
+./student_records_bench --dir DIR          where the files are created (default bench_data)
+./student_records_bench --generate-only    only write DIR/students.dat
+-----------------------------------
+*/
+
+#define STUDENT_RECORDS_NO_MAIN
+#include "student_records.c"
+
+#include "../../Common/code/bench.h"
+
+#define DEFAULT_RECORDS 90000
+#define DEFAULT_OPS 1000
+#define FIRST_NAMES 64
+#define LAST_NAMES 1024   // Distinct last names, so a search finds about records / LAST_NAMES rows
+
+// Keeps the optimizer from dropping the work being timed
+static volatile long sink;
+
+// Small fixed-seed generator, so every run uses the same dataset
+static unsigned long long randomState = 88172645463325252ULL;
+
+static unsigned long nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return (unsigned long)(randomState >> 16);
+}
+
+static const char *firstNames[FIRST_NAMES] = {
+    "Maria", "Georgios", "Eleni", "Ioannis", "Katerina", "Dimitris", "Sofia", "Nikos",
+    "Anna", "Kostas", "Vasiliki", "Panagiotis", "Christina", "Vaggelis", "Despoina", "Thanos",
+    "Irini", "Michalis", "Angeliki", "Stavros", "Dimitra", "Petros", "Georgia", "Alexandros",
+    "Evangelia", "Spyros", "Athina", "Manolis", "Paraskevi", "Christos", "Ioanna", "Andreas",
+    "Theodora", "Antonis", "Kalliopi", "Apostolis", "Marina", "Stelios", "Konstantina", "Lefteris",
+    "Olga", "Yannis", "Zoe", "Babis", "Niki", "Takis", "Roula", "Fotis",
+    "Chrysa", "Makis", "Efi", "Sakis", "Lina", "Thodoris", "Rena", "Aris",
+    "Mirto", "Giorgos", "Elpida", "Markos", "Danai", "Lambros", "Fani", "Orestis"
+};
+
+static const char *syllables[16] = {
+    "pa", "pe", "ko", "ni", "da", "ka", "lo", "ra", "to", "mi", "sta", "the", "xa", "vra", "gi", "lu"
+};
+
+static char lastNames[LAST_NAMES][24];
+
+// Last name i: three syllables picked by the digits of i plus a common ending
+static void makeLastNames() {
+    static const char *endings[4] = {"poulos", "akis", "idis", "ou"};
+    for (int i = 0; i < LAST_NAMES; i++) {
+        snprintf(lastNames[i], sizeof(lastNames[i]), "%s%s%s%s",
+                 syllables[i % 16], syllables[(i / 16) % 16], syllables[(i / 256) % 16], endings[i % 4]);
+        lastNames[i][0] = (char)toupper((unsigned char)lastNames[i][0]);
+    }
+}
+
+static void makeStudent(struct Student *s, int slot) {
+    memset(s, 0, sizeof(*s));
+    snprintf(s->roll, sizeof(s->roll), "AM%05d", slot);
+    strcpy(s->firstName, firstNames[nextRandom() % FIRST_NAMES]);
+    strcpy(s->lastName, lastNames[nextRandom() % LAST_NAMES]);
+}
+
+// Roll slots in random order: the first records ones are in the dataset,
+// the rest are free for the add benchmark
+static int slots[ROLL_SLOTS];
+
+static void shuffleSlots() {
+    for (int i = 0; i < ROLL_SLOTS; i++) slots[i] = i;
+    for (int i = ROLL_SLOTS - 1; i > 0; i--) {
+        int j = (int)(nextRandom() % (unsigned long)(i + 1));
+        int t = slots[i];
+        slots[i] = slots[j];
+        slots[j] = t;
+    }
+}
+
+// Write students.dat with records students and no journal; returns 1 on success
+static int generateStudents(long records) {
+    RecWriter w;
+    struct Student s;
+
+    remove(JOURNAL_FILE);
+    if (!recWriterOpen(&w, FILE_NAME, RECTYPE_STUDENT, sizeof(struct Student), 0)) return 0;
+    for (long i = 0; i < records; i++) {
+        makeStudent(&s, slots[i]);
+        recWriterAdd(&w, &s);
+    }
+    return recWriterClose(&w);
+}
+
+// Time writeExport into a file
+static void benchExport(const char *name, const char *path, int format) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, " Could not create %s\n", path);
+        return;
+    }
+    double start = benchNow();
+    long rows = writeExport(out, format);
+    fflush(out);
+    double elapsed = benchNow() - start;
+    fclose(out);
+    benchReportOnce(name, elapsed, rows);
+}
+
+int main(int argc, char *argv[]) {
+    long records = DEFAULT_RECORDS;
+    long ops = DEFAULT_OPS;
+    const char *dir = "bench_data";
+    int generateOnly = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) {
+            records = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            benchSetJson(1);
+        } else if (strcmp(argv[i], "--generate-only") == 0) {
+            generateOnly = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--records N] [--ops N] [--json] [--dir DIR] [--generate-only]\n", argv[0]);
+            return EXIT_USAGE;
+        }
+    }
+
+    // The adds need free roll numbers
+    if (ops < 1) ops = 1;
+    if (ops > ROLL_SLOTS / 2) ops = ROLL_SLOTS / 2;
+    if (records < 1) records = 1;
+    if (records > ROLL_SLOTS - ops) {
+        records = ROLL_SLOTS - ops;
+        fprintf(stderr, " Roll numbers allow at most %ld students with %ld adds.\n", records, ops);
+    }
+
+    if (!benchEnterDir(dir)) {
+        fprintf(stderr, " Could not use the directory %s\n", dir);
+        return EXIT_STORAGE;
+    }
+
+    makeLastNames();
+    shuffleSlots();
+    benchPrintHeader("student_records", records);
+
+    double start = benchNow();
+    if (!generateStudents(records)) {
+        fprintf(stderr, " Could not write %s/%s\n", dir, FILE_NAME);
+        return EXIT_STORAGE;
+    }
+    benchReportOnce("generate", benchNow() - start, records);
+    if (generateOnly) return EXIT_OK;
+
+    start = benchNow();
+    loadStudents(0);
+    benchReportOnce("load", benchNow() - start, records);
+
+    BenchTimer t;
+    struct Student s;
+    const char *result;
+
+    // Add: new roll numbers, through the same validation and duplicate check as the add command
+    benchInit(&t, "add", ops);
+    for (long i = 0; i < ops; i++) {
+        makeStudent(&s, slots[records + i]);
+        start = benchNow();
+        result = opAdd(s.roll, s.firstName, s.lastName);
+        benchAdd(&t, benchNow() - start);
+        if (result) fprintf(stderr, " add %s: %s\n", s.roll, result);
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    benchInit(&t, "add_duplicate", ops);
+    for (long i = 0; i < ops; i++) {
+        makeStudent(&s, slots[nextRandom() % records]);
+        start = benchNow();
+        result = opAdd(s.roll, s.firstName, s.lastName);
+        benchAdd(&t, benchNow() - start);
+        sink += result != NULL;
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    // Get by roll number, half of them missing
+    benchInit(&t, "get_roll", ops);
+    for (long i = 0; i < ops; i++) {
+        char roll[ROLL_LEN];
+        snprintf(roll, sizeof(roll), "AM%05d", (int)(nextRandom() % ROLL_SLOTS));
+        start = benchNow();
+        int slot = rollSlot(roll);
+        sink += slot >= 0 && rollIndex[slot] >= 0 ? rollIndex[slot] : 0;
+        benchAdd(&t, benchNow() - start);
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    // Search by last name: every match is visited, as the search command prints them
+    long matches = 0;
+    benchInit(&t, "search_last_name", ops);
+    for (long i = 0; i < ops; i++) {
+        const char *key = lastNames[nextRandom() % LAST_NAMES];
+        start = benchNow();
+        for (long m = nextNameMatch(findNameStart(key), key, MATCH_EXACT); m >= 0;
+             m = nextNameMatch(m + 1, key, MATCH_EXACT)) {
+            sink += nameIndex[m];
+            matches++;
+        }
+        benchAdd(&t, benchNow() - start);
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    benchInit(&t, "search_prefix", ops);
+    for (long i = 0; i < ops; i++) {
+        char key[3] = {0};
+        memcpy(key, lastNames[nextRandom() % LAST_NAMES], 2);
+        start = benchNow();
+        for (long m = nextNameMatch(findNameStart(key), key, MATCH_PREFIX); m >= 0;
+             m = nextNameMatch(m + 1, key, MATCH_PREFIX)) {
+            sink += nameIndex[m];
+        }
+        benchAdd(&t, benchNow() - start);
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    benchExport("export_csv", "export.csv", EXPORT_CSV);
+    benchExport("export_jsonl", "export.jsonl", EXPORT_JSONL);
+
+    // Delete students of the dataset; stays below the compaction threshold when it can
+    long deletes = ops;
+    if (deletes > records / (COMPACT_RATIO + 1)) deletes = records / (COMPACT_RATIO + 1);
+    benchInit(&t, "delete", deletes);
+    for (long i = 0; i < deletes; i++) {
+        snprintf(s.roll, sizeof(s.roll), "AM%05d", slots[i]);
+        start = benchNow();
+        result = opDelete(s.roll);
+        benchAdd(&t, benchNow() - start);
+        if (result) fprintf(stderr, " delete %s: %s\n", s.roll, result);
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    // Checkpoint: the deleted records are zeroed in place, the journal is emptied
+    long changes = db.changes;
+    start = benchNow();
+    if (!checkpointStudents()) return EXIT_STORAGE;
+    benchReportOnce("checkpoint", benchNow() - start, changes);
+
+    long live = store.count - store.deadCount;
+    start = benchNow();
+    if (!rewriteStudents()) return EXIT_STORAGE;
+    benchReportOnce("compact_rewrite", benchNow() - start, live);
+
+    benchReportValue("search_matches", matches);
+    benchReportValue("checkpoints", db.checkpoints);
+    benchReportValue("full_rewrites", db.fullRewrites);
+    benchReportValue("records_written", db.recordsWritten);
+    benchReportValue("peak_rss_kb", benchPeakRssKb());
+
+    recStoreClose(&db);
+    return EXIT_OK;
+}
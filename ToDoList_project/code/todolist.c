@@ -1,518 +1,1939 @@
-/*
-===========================================================
-    Stylish To-Do List Application in C (Terminal-based)
-===========================================================
-
-Description:
-------------
-This is a terminal-based To-Do List application built in C.
-It allows users to manage tasks with features like:
-
-✔ Add new tasks with deadline, priority, and category
-✔ Mark tasks as completed
-✔ Delete and edit existing tasks
-✔ Sort tasks by deadline (earliest first)
-✔ Color-coded display for priority, category, and status
-✔ Filter tasks by category (Work, Study, Personal, Other)
-✔ Highlight overdue tasks
-✔ Save/load tasks from a local binary file (tasks.dat)
-
-Color Legend:
--------------
-- 🔴 High Priority     → Red
-- 🟡 Medium Priority   → Yellow
-- 🟣 Low Priority      → Magenta
-- 🔵 Study Category    → Blue
-- 🟡 Work Category     → Yellow
-- 🟣 Personal Category → Magenta
-- ⚪ Other Category     → Gray
-
-File Structure:
----------------
-- Struct: `Task` holds all task info
-- Main Loop: Displays menu, handles user input
-- File I/O: Saves/loads tasks on start/exit
-- Logic: Deadline parsing, sorting, filtering, coloring
-
-Made for Windows Terminal (requires windows.h for color).
-
-Author: Vaggelis Papaioannou
-
-*/
-
-#include <stdio.h>
-#include <string.h>
-#include <windows.h>  // For color support on Windows
-#include <time.h>
-
-#define MAX_TASKS 100
-#define MAX_LENGTH 100
-
-// Windows color codes
-#define RESET   15
-#define BLUE    9
-#define GREEN   10
-#define RED     12
-#define YELLOW  14
-#define MAGENTA 13
-#define GRAY    8
-#define SAVE_FILE "tasks.dat"
-
-// Task structure
-typedef struct {
-    char description[MAX_LENGTH];
-    char deadline[20];
-    int priority;
-    int completed;
-    char category[20];  // New: Category field
-} Task;
-
-// Function declarations
-void setColor(int color);
-void printHeader();
-void addTask(Task tasks[], int *taskCount);
-void viewTasks(Task tasks[], int taskCount);
-void completeTask(Task tasks[], int taskCount);
-void deleteTask(Task tasks[], int *taskCount);
-void saveTasks(Task tasks[], int taskCount);
-void loadTasks(Task tasks[], int *taskCount);
-void editTask(Task tasks[], int taskCount);
-int compareDates(const void *a, const void *b);
-void parseDate(const char *dateStr, struct tm *date);
-
-int main() {
-    Task tasks[MAX_TASKS];      // Array to hold all tasks
-    int taskCount = 0;          // Total number of tasks
-    int choice;                 // User menu choice
-
-    loadTasks(tasks, &taskCount);  // Load saved tasks from file at program start
-
-    do {
-        printHeader();              // Print the stylized header
-
-        // Display menu options
-        setColor(BLUE);
-        printf("1. Add Task\n");
-        printf("2. View Tasks\n");
-        printf("3. Mark Task as Completed\n");
-        printf("4. Delete Task\n");
-        printf("5. Edit Task\n");
-        printf("6. Exit\n");
-        setColor(YELLOW);
-        printf("Choose an option: ");
-        setColor(RESET);
-
-        scanf("%d", &choice);
-        getchar(); // Clear leftover newline from input buffer
-
-        // Execute action based on user's menu choice
-        switch (choice) {
-            case 1:
-                addTask(tasks, &taskCount);      // Add a new task
-                break;
-            case 2:
-                viewTasks(tasks, taskCount);     // Display all tasks (with filtering)
-                break;
-            case 3:
-                completeTask(tasks, taskCount);  // Mark a task as completed
-                break;
-            case 4:
-                deleteTask(tasks, &taskCount);   // Delete a task by number
-                break;
-            case 5:
-                editTask(tasks, taskCount);      // Edit an existing task
-                break;
-            case 6:
-                saveTasks(tasks, taskCount);     // Save all tasks to file before exiting
-                setColor(GREEN);
-                printf("Exiting program...\n");
-                setColor(RESET);
-                break;
-            default:
-                setColor(RED);
-                printf("Invalid choice. Try again.\n"); // Handle invalid input
-                setColor(RESET);
-        }
-    } while (choice != 6);  // Loop until user chooses to exit
-
-    return 0;  // Successful program termination
-}
-
-
-// Sets the text color in the Windows console
-void setColor(int color) {
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);   // Get handle to standard output
-    SetConsoleTextAttribute(hConsole, color);            // Set the text color using color code
-}
-
-// Prints a styled header at the top of the menu
-void printHeader() {
-    setColor(BLUE);  // Set text color to blue
-    printf("\n***************************************\n");
-    printf("*        Stylish To-Do List Menu       *\n");
-    printf("***************************************\n");
-    setColor(RESET); // Reset to default console color
-}
-
-
-
-// Adds a new task to the task list
-void addTask(Task tasks[], int *taskCount) {
-    // Check if task list has reached its maximum capacity
-    if (*taskCount >= MAX_TASKS) {
-        setColor(RED);
-        printf("Task list is full!\n");
-        setColor(RESET);
-        return;
-    }
-
-    Task newTask;
-
-    // Prompt and read task description
-    setColor(YELLOW);
-    printf("Enter task description: ");
-    setColor(RESET);
-    fgets(newTask.description, MAX_LENGTH, stdin);
-    newTask.description[strcspn(newTask.description, "\n")] = '\0';  // Remove trailing newline
-
-    // Prompt and read deadline
-    printf("Enter deadline (e.g., 2025-06-30): ");
-    fgets(newTask.deadline, 20, stdin);
-    newTask.deadline[strcspn(newTask.deadline, "\n")] = '\0';
-
-    // Prompt and read priority (1-High, 2-Medium, 3-Low)
-    printf("Enter priority (1 = High, 2 = Medium, 3 = Low): ");
-    scanf("%d", &newTask.priority);
-    getchar();  // Clear newline from buffer
-
-    // Prompt and read task category
-    setColor(YELLOW);
-    printf("Enter category [Study, Work, Personal, Other]: ");
-    setColor(RESET);
-    fgets(newTask.category, 20, stdin);
-    newTask.category[strcspn(newTask.category, "\n")] = '\0';
-
-    // Initialize task as not completed
-    newTask.completed = 0;
-
-    // Add task to the array and increment task count
-    tasks[*taskCount] = newTask;
-    (*taskCount)++;
-
-    setColor(GREEN);
-    printf(" Task added successfully.\n");
-    setColor(RESET);
-}
-
-
-// Displays all tasks, optionally filtered by category and sorted by deadline
-void viewTasks(Task tasks[], int taskCount) {
-    if (taskCount == 0) {
-        // No tasks to show
-        setColor(RED);
-        printf("No tasks to show.\n");
-        setColor(RESET);
-        return;
-    }
-
-    // Ask user to choose a filter by category
-    setColor(YELLOW);
-    printf("\nView Options:\n");
-    printf("1. Work\n2. Study\n3. Personal\n4. Other\n5. All\nChoose filter: ");
-    setColor(RESET);
-
-    int filterChoice;
-    scanf("%d", &filterChoice);
-    getchar();  // Clear newline from buffer
-
-    // Map numeric choice to category string
-    char filterCategory[20] = "";
-    switch (filterChoice) {
-        case 1: strcpy(filterCategory, "Work"); break;
-        case 2: strcpy(filterCategory, "Study"); break;
-        case 3: strcpy(filterCategory, "Personal"); break;
-        case 4: strcpy(filterCategory, "Other"); break;
-        case 5: strcpy(filterCategory, "ALL"); break;
-        default:
-            // Invalid choice, fallback to showing all
-            setColor(RED);
-            printf("Invalid choice. Showing all tasks.\n");
-            setColor(RESET);
-            strcpy(filterCategory, "ALL");
-    }
-
-    // Sort tasks by deadline (soonest first)
-    qsort(tasks, taskCount, sizeof(Task), compareDates);
-
-    // Print column headers
-    setColor(BLUE);
-    printf("\n%-3s %-30s %-12s %-10s %-10s %-12s %-10s\n", 
-           "No", "Description", "Deadline", "Priority", "Status", "Category", "Due In");
-    setColor(RESET);
-
-    time_t now = time(NULL);  // Current system time
-
-    for (int i = 0; i < taskCount; i++) {
-        // Apply filter: skip task if it doesn't match selected category
-        if (strcmp(filterCategory, "ALL") != 0 && strcasecmp(tasks[i].category, filterCategory) != 0)
-            continue;
-
-        // Convert deadline string to struct tm
-        struct tm taskDate = {0};
-        parseDate(tasks[i].deadline, &taskDate);
-        time_t taskTime = mktime(&taskDate);
-
-        // Calculate days remaining until deadline
-        double daysRemaining = difftime(taskTime, now) / (60 * 60 * 24);
-        char dayStr[20];
-        if (tasks[i].completed)
-            strcpy(dayStr, "—");  // Not applicable for completed tasks
-        else if (daysRemaining < 0)
-            strcpy(dayStr, "Overdue");  // Task is overdue
-        else
-            sprintf(dayStr, "%.0f days", daysRemaining);  // Days left
-
-        // Highlight overdue tasks in red
-        int isOverdue = (!tasks[i].completed && difftime(taskTime, now) < 0);
-        if (isOverdue) setColor(RED);
-        else setColor(RESET);
-
-        // Print description and deadline
-        printf("%-3d %-30s %-12s ", i + 1, tasks[i].description, tasks[i].deadline);
-
-        // Print and color-code priority
-        switch (tasks[i].priority) {
-            case 1: setColor(RED);     printf("%-10s ", "High"); break;
-            case 2: setColor(YELLOW);  printf("%-10s ", "Medium"); break;
-            case 3: setColor(MAGENTA); printf("%-10s ", "Low"); break;
-            default: setColor(RESET);  printf("%-10s ", "Unknown");
-        }
-
-        // Print completion status
-        setColor(tasks[i].completed ? GREEN : RED);
-        printf("%-10s ", tasks[i].completed ? " Done" : "Open");
-
-        // Print category with color based on type
-        if (strcmp(tasks[i].category, "Study") == 0) setColor(BLUE);
-        else if (strcmp(tasks[i].category, "Work") == 0) setColor(YELLOW);
-        else if (strcmp(tasks[i].category, "Personal") == 0) setColor(MAGENTA);
-        else setColor(GRAY);  // Default color for "Other" or unknown
-
-        printf("%-12s ", tasks[i].category);
-
-        // Print "due in" info
-        setColor(isOverdue ? RED : RESET);
-        printf("%-10s\n", dayStr);
-
-        setColor(RESET);  // Reset color after each task
-    }
-}
-
-// Marks a specific task as completed based on user input
-void completeTask(Task tasks[], int taskCount) {
-    int number;
-
-    // Prompt the user for the task number to mark as completed
-    setColor(YELLOW);
-    printf("Enter task number to mark as completed: ");
-    setColor(RESET);
-    scanf("%d", &number);
-
-    // Validate the entered task number
-    if (number < 1 || number > taskCount) {
-        setColor(RED);
-        printf("Invalid task number!\n");  // Error if out of bounds
-        setColor(RESET);
-        return;
-    }
-
-    // Mark the corresponding task as completed
-    tasks[number - 1].completed = 1;
-
-    // Confirm to user
-    setColor(GREEN);
-    printf("Task marked as completed.\n");
-    setColor(RESET);
-}
-
-
-// Deletes a task from the list based on the user's input
-void deleteTask(Task tasks[], int *taskCount) {
-    int number;
-
-    // Prompt user to enter the number of the task they want to delete
-    setColor(YELLOW);
-    printf("Enter task number to delete: ");
-    setColor(RESET);
-    scanf("%d", &number);
-
-    // Validate the task number
-    if (number < 1 || number > *taskCount) {
-        setColor(RED);
-        printf("Invalid task number!\n");  // Print error if out of range
-        setColor(RESET);
-        return;
-    }
-
-    // Shift all tasks after the deleted one one position to the left
-    for (int i = number - 1; i < *taskCount - 1; i++) {
-        tasks[i] = tasks[i + 1];  // Overwrite current task with the next one
-    }
-
-    // Reduce the total task count by 1
-    (*taskCount)--;
-
-    // Notify the user of successful deletion
-    setColor(GREEN);
-    printf("Task deleted.\n");
-    setColor(RESET);
-}
-
-
-// Saves all tasks to a binary file for persistence between sessions
-void saveTasks(Task tasks[], int taskCount) {
-    // Open the save file in binary write mode
-    FILE *fp = fopen(SAVE_FILE, "wb");
-    
-    // If file couldn't be opened, print error and exit
-    if (!fp) {
-        setColor(RED);
-        printf("Failed to save tasks.\n");
-        setColor(RESET);
-        return;
-    }
-
-    // First, write the number of tasks to the file
-    fwrite(&taskCount, sizeof(int), 1, fp);  // Save the task count
-
-    // Then, write the entire array of tasks
-    fwrite(tasks, sizeof(Task), taskCount, fp);  // Save all task data
-
-    // Close the file after writing
-    fclose(fp);
-}
-
-
-// Loads tasks from a binary file into memory at program startup
-void loadTasks(Task tasks[], int *taskCount) {
-    // Open the saved file in binary read mode
-    FILE *fp = fopen(SAVE_FILE, "rb");
-
-    // If the file doesn't exist (first run), exit silently
-    if (!fp) return;
-
-    // Read the number of tasks first (stored as an integer)
-    fread(taskCount, sizeof(int), 1, fp);
-
-    // Read the array of Task structs into memory
-    fread(tasks, sizeof(Task), *taskCount, fp);
-
-    // Close the file after loading
-    fclose(fp);
-}
-
-
-// Comparison function used by qsort to sort tasks by their deadline date
-int compareDates(const void *a, const void *b) {
-    // Cast the generic pointers to Task pointers
-    const Task *taskA = (const Task *)a;
-    const Task *taskB = (const Task *)b;
-
-    // Create tm structs to hold parsed date values
-    struct tm dateA = {0}, dateB = {0};
-
-    // Parse each task's deadline string into the tm structs
-    parseDate(taskA->deadline, &dateA);
-    parseDate(taskB->deadline, &dateB);
-
-    // Convert the tm structs into time_t values (UNIX timestamps)
-    time_t timeA = mktime(&dateA);
-    time_t timeB = mktime(&dateB);
-
-    // Return the difference between the two deadlines
-    // Positive if taskA is later than taskB, negative if earlier
-    return difftime(timeA, timeB);  // Ascending order
-}
-
-
-// Function to edit an existing task's details: description, deadline, and priority
-void editTask(Task tasks[], int taskCount) {
-    // Handle empty task list
-    if (taskCount == 0) {
-        setColor(RED);
-        printf("No tasks available to edit.\n");
-        setColor(RESET);
-        return;
-    }
-
-    // Ask user for task number to edit
-    int number;
-    setColor(YELLOW);
-    printf("Enter task number to edit: ");
-    setColor(RESET);
-    scanf("%d", &number);
-    getchar(); // Clear newline character left in buffer
-
-    // Validate task number input
-    if (number < 1 || number > taskCount) {
-        setColor(RED);
-        printf("Invalid task number!\n");
-        setColor(RESET);
-        return;
-    }
-
-    // Get pointer to the selected task
-    Task *t = &tasks[number - 1];
-
-    // Show current description and ask for new one
-    setColor(YELLOW);
-    printf("Editing Task %d:\n", number);
-    printf("Current Description: %s\n", t->description);
-    printf("Enter new description (or press Enter to keep): ");
-    setColor(RESET);
-
-    char input[MAX_LENGTH];
-    fgets(input, MAX_LENGTH, stdin);
-    if (strcmp(input, "\n") != 0) {
-        input[strcspn(input, "\n")] = '\0';  // Remove newline
-        strcpy(t->description, input);      // Update description
-    }
-
-    // Update deadline if new input is provided
-    setColor(YELLOW);
-    printf("Current Deadline: %s\n", t->deadline);
-    printf("Enter new deadline (YYYY-MM-DD) (or press Enter to keep): ");
-    setColor(RESET);
-    fgets(input, 20, stdin);
-    if (strcmp(input, "\n") != 0) {
-        input[strcspn(input, "\n")] = '\0';
-        strcpy(t->deadline, input);
-    }
-
-    // Update priority if new valid number is provided
-    setColor(YELLOW);
-    printf("Current Priority: %d\n", t->priority);
-    printf("Enter new priority (1=High, 2=Medium, 3=Low) or 0 to keep: ");
-    setColor(RESET);
-    int newPriority;
-    scanf("%d", &newPriority);
-    getchar();  // Clear input buffer again
-    if (newPriority >= 1 && newPriority <= 3) {
-        t->priority = newPriority;
-    }
-
-    setColor(GREEN);
-    printf("Task updated successfully!\n");
-    setColor(RESET);
-}
-
-// Parse "YYYY-MM-DD" into struct tm
-void parseDate(const char *dateStr, struct tm *date) {
-    sscanf(dateStr, "%d-%d-%d",
-           &date->tm_year, &date->tm_mon, &date->tm_mday);
-    date->tm_year -= 1900;  // Year since 1900
-    date->tm_mon -= 1;      // Month is 0-based
-    date->tm_hour = 0;
-    date->tm_min = 0;
-    date->tm_sec = 0;
-}
\ No newline at end of file
+/*
+===========================================================
+    Stylish To-Do List Application in C (Terminal-based)
+===========================================================
+
+Description:
+------------
+This is a terminal-based To-Do List application built in C.
+It allows users to manage tasks with features like:
+
+✔ Add new tasks with deadline, priority, and category
+✔ Mark tasks as completed
+✔ Delete and edit existing tasks
+✔ Tasks are always listed by deadline (earliest first, then by priority)
+  through an ordered index kept up to date on every change
+✔ Every task has a stable ID used to complete, delete and edit it
+✔ No limit on the number of tasks: they live in heap slabs of TASK_SLAB
+  tasks, deleted slots go on a free list (O(1) delete, nothing is moved)
+✔ Color-coded display for priority, category, and status
+✔ Filter tasks by category (Work, Study, Personal, Other, or any category
+  the user types): categories are interned once and every category keeps
+  its own ordered list of tasks, so a filtered view only walks its tasks
+✔ Highlight overdue tasks
+✔ Overdue / due-soon queries (menu option 7, queryDeadlines) answered from
+  a deadline index of the open tasks with two binary searches
+✔ Save/load tasks from a local binary file (tasks.dat) in the shared
+  record file format (Common/code/recfile.h): versioned header and a CRC
+  per block of tasks, so a damaged or truncated file is detected on load
+✔ Every change is appended to a journal (tasks.jnl) as it is made, so a
+  crash loses nothing; tasks.dat is updated only at checkpoints (on exit,
+  every CHECKPOINT_EVERY changes and every AUTOSAVE_SECONDS)
+✔ Record i of tasks.dat is slot i of the store, so a checkpoint only
+  writes the slots changed since the last one (in place) and appends the
+  new ones; the whole file is rewritten only when it does not match
+  (loading, journaling and checkpoints are the record store shared with
+  the Student Record System, Common/code/recstore.h)
+✔ Shared mode for several consoles: `todolist --server` owns the files and
+  answers requests on a local socket next to them (SERVER_SOCKET, which
+  only the account running the server may open); every todolist started
+  in that directory while it runs becomes a client of it (without a server it works alone, as
+  before). The server is one select loop, so reads need no locks, and the
+  changes that arrive together are journaled with a single fsync
+
+Color Legend:
+-------------
+- 🔴 High Priority     → Red
+- 🟡 Medium Priority   → Yellow
+- 🟣 Low Priority      → Magenta
+- 🔵 Study Category    → Blue
+- 🟡 Work Category     → Yellow
+- 🟣 Personal Category → Magenta
+- ⚪ Other Category     → Gray
+
+File Structure:
+---------------
+- Struct: `Task` holds all task info, `TaskStore` holds all tasks
+- Main Loop: Displays menu, handles user input
+- File I/O: Saves/loads tasks on start/exit
+- Logic: Deadline parsing, sorting, filtering, coloring
+
+Colors are ANSI escape sequences: the task table is built in one buffer
+and written with a single call, PAGE_ROWS tasks per page. On Windows the
+console is switched to VT mode once at startup (Windows 10 or later); on
+other systems, or when the output is not a terminal, it runs the same way
+(without colors when redirected).
+
+To compile:
+-----------------------------------
+gcc -o todolist todolist.c ../../Common/code/recfile.c ../../Common/code/journal.c ../../Common/code/recstore.c
+-----------------------------------
+(on Windows add -lws2_32 for the sockets; the local socket needs Windows 10 1803 or later)
+
+Author: Vaggelis Papaioannou
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <winsock2.h>  // Server mode (must come before windows.h)
+#include <afunix.h>
+#include <windows.h>   // To enable ANSI colors in the Windows console
+#include <aclapi.h>
+#include <io.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004  // Missing from older MinGW headers
+#endif
+#define isatty _isatty
+#define fileno _fileno
+#define closeSocket closesocket
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define closeSocket close
+#endif
+
+#include "../../Common/code/recfile.h"
+#include "../../Common/code/journal.h"
+#include "../../Common/code/recstore.h"
+
+#define MAX_LENGTH 100
+#define TASK_SLAB 1024  // Tasks per slab: a slab never moves, so tasks keep their address
+#define CATEGORY_OTHER 3  // Category of tasks without one (see initStore for the built-in ones)
+#define PAGE_ROWS 40      // Tasks per page of viewTasks
+
+// Color codes (the Windows console attributes; setColor maps them to ANSI)
+#define RESET   15
+#define BLUE    9
+#define GREEN   10
+#define RED     12
+#define YELLOW  14
+#define MAGENTA 13
+#define GRAY    8
+#define SAVE_FILE "tasks.dat"
+#define JOURNAL_FILE "tasks.jnl"
+#define JOURNAL_SYNC_EVERY 1   // fsync the journal after every change (0 = leave it to the OS)
+#define CHECKPOINT_EVERY 50    // Changes between saves of tasks.dat
+#define AUTOSAVE_SECONDS 60    // Unsaved changes older than this are saved from the menu loop
+#define NO_DEADLINE INT_MAX    // deadlineDays of a deadline that is not a valid date (sorts last)
+
+// Journal operations (2 to 5 were the position-based operations of older versions;
+// positions mean nothing in the task store, so those entries are skipped)
+#define OP_ADD 1            // Payload: Task
+#define OP_EDIT_TASK 6      // Payload: Task, replaces the task with the same id (consoles send REQ_EDIT)
+#define OP_COMPLETE_TASK 7  // Payload: int id
+#define OP_DELETE_TASK 8    // Payload: int id
+
+// Server mode (todolist --server): the changes above plus these reads are the requests
+#define SERVER_SOCKET "tasks.sock"  // Unix-domain socket of the server, next to tasks.dat
+#define MAX_CLIENTS 60      // Below FD_SETSIZE everywhere (64 on Windows)
+#define MAX_CLIENT_OUTPUT (4 << 20)  // Unread replies a client may pile up before it is dropped
+#define REQ_LIST 100        // Payload: ListRequest; items: TaskRow, a page of a category or of all tasks
+#define REQ_QUERY 101       // Payload: ListRequest; items: TaskRow, open tasks due in [fromDays, toDays]
+#define REQ_CATEGORIES 102  // No payload; items: CategoryRow
+#define REQ_GET 103         // Payload: int id; items: one TaskRow
+#define REQ_EDIT 104        // Payload: TaskEdit; journaled as OP_EDIT_TASK of the task it makes
+
+// Reply.status
+#define REPLY_OK 0
+#define REPLY_NOT_FOUND 1    // No task with that ID (or no such category)
+#define REPLY_FAILED 2       // Not saved, out of memory or no connection
+#define REPLY_BAD_REQUEST 3
+
+// Task structure
+typedef struct {
+    char description[MAX_LENGTH];
+    char deadline[20];
+    int priority;
+    int completed;
+    char category[20];  // New: Category field
+    int deadlineDays;   // deadline as days since 1970-01-01, set by setDeadlineDays
+    int id;             // Stable ID shown to the user, never reused
+} Task;
+
+// Size of a task before deadlineDays was added (old tasks.dat and journal entries)
+#define TASK_V1_SIZE offsetof(Task, deadlineDays)
+
+// Slots of tasks in display order (deadline, then priority, then id)
+typedef struct {
+    int *slots;
+    int count;
+    int capacity;
+} OrderIndex;
+
+// An interned category; tasks refer to it by its position in the table
+typedef struct {
+    char name[20];     // Spelling of the first task seen with it (matched ignoring case)
+    int color;
+    OrderIndex tasks;  // This category's tasks in display order
+} Category;
+
+// All tasks, in slabs of TASK_SLAB slots allocated as the list grows
+typedef struct {
+    Task **slabs;
+    int slabCount;
+    int used;          // Slots handed out so far (a free slot has id 0)
+    int count;         // Tasks in the store
+    int *nextFree;     // Free list of deleted slots, chained through nextFree[slot]
+    int freeHead;      // First free slot, -1 if none
+    int *idSlot;       // Slot of each ID, -1 once the task is deleted
+    int idCapacity;
+    int nextId;
+    OrderIndex order;  // All tasks in display order
+    OrderIndex open;   // Tasks not completed, in display order (deadline first)
+    int *categoryOf;   // Category of the task in each slot
+    Category *categories;
+    int categoryCount;
+    RecStore files;    // tasks.dat and tasks.jnl; record i of tasks.dat is slot i
+    int dropped;       // Loading: tasks that could not be stored (out of memory)
+    int renumbered;    // Loading: tasks that got a new ID (files written before IDs)
+    int misplaced;     // Loading: records that did not get the slot of their index
+} TaskStore;
+
+// Growable output buffer: a page of the task table is built here and written at once
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int color;  // Current color, so repeated colors cost nothing
+} RenderBuffer;
+
+// Every request starts with this header, followed by length bytes of payload
+typedef struct {
+    uint32_t length;
+    uint32_t op;  // OP_* change, REQ_EDIT or a REQ_* read
+} RequestHeader;
+
+// Payload of REQ_LIST and REQ_QUERY: a page (offset, limit) of a list in display order
+typedef struct {
+    int32_t category;  // REQ_LIST: position in the category table, -1 for all tasks
+    int32_t fromDays;  // REQ_QUERY: deadline range, days since 1970-01-01
+    int32_t toDays;
+    int32_t offset;
+    int32_t limit;
+} ListRequest;
+
+// Payload of REQ_EDIT: only the fields the user changed, applied to the task as it is
+// then, so a change another user made in the meantime (completed, category) is kept
+typedef struct {
+    int32_t id;
+    char description[MAX_LENGTH];  // "" = keep
+    char deadline[20];             // "" = keep
+    int32_t priority;              // 0 = keep
+} TaskEdit;
+
+// Every reply starts with this, followed by bytes bytes of items
+typedef struct {
+    int32_t status;  // REPLY_*
+    int32_t count;   // Items in this reply
+    int32_t total;   // Items in the whole list (count is at most limit of them)
+    int32_t id;      // ID of the task added or changed
+    uint32_t bytes;
+} Reply;
+
+typedef struct {
+    Task task;
+    int32_t color;  // Color of its category
+} TaskRow;
+
+typedef struct {
+    char name[20];
+    int32_t color;
+} CategoryRow;
+
+// Growable buffer of replies
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} ReplyBuffer;
+
+// Where the console sends its requests: its own store, or a server it is connected to
+typedef struct {
+    TaskStore *store;   // NULL when connected to a server
+    SOCKET server;
+    ReplyBuffer reply;  // The last reply
+    const char *items;  // Its items
+} Backend;
+
+// A console connected to the server
+typedef struct {
+    SOCKET fd;
+    unsigned char in[sizeof(RequestHeader) + JOURNAL_MAX_PAYLOAD];  // Longest request
+    size_t inLength;
+    ReplyBuffer out;  // Replies not sent yet (the ones of this round wait for its journal sync)
+    size_t sent;      // Bytes of out already sent
+    int closed;
+} Client;
+
+// Colors are only written to a terminal that understands them (see initConsole)
+static int useColor = 0;
+
+// Function declarations
+void initConsole();
+const char *ansiColor(int color);
+void setColor(int color);
+void renderColor(RenderBuffer *out, int color);
+void renderPrintf(RenderBuffer *out, const char *format, ...);
+void renderFlush(RenderBuffer *out);
+void printHeader();
+void addTask(Backend *b);
+void viewTasks(Backend *b);
+void completeTask(Backend *b);
+void deleteTask(Backend *b);
+void saveTasks(TaskStore *store);
+void autosave(TaskStore *store);
+void loadTasks(TaskStore *store);
+void editTask(Backend *b);
+int compareDates(const void *a, const void *b);
+int applyChange(TaskStore *store, uint32_t op, const void *payload, uint32_t length);
+int logChange(TaskStore *store, uint32_t op, const void *payload, uint32_t length);
+int daysFromCivil(int year, int month, int day);
+int parseDeadline(const char *dateStr);
+void setDeadlineDays(Task *t);
+int todayDays();
+void initStore(TaskStore *store);
+void freeStore(TaskStore *store);
+Task *taskAt(TaskStore *store, int slot);
+int findTask(TaskStore *store, int id);
+int allocSlot(TaskStore *store);
+int storeAdd(TaskStore *store, const void *data, size_t size, int ordered);
+void storeRemove(TaskStore *store, int slot);
+void markDirty(TaskStore *store, int slot);
+int internCategory(TaskStore *store, const char *name);
+int orderInsert(TaskStore *store, int slot);
+void orderRemove(TaskStore *store, int slot);
+void markCompleted(TaskStore *store, int slot);
+int rebuildOrder(TaskStore *store);
+int queryDeadlines(TaskStore *store, int fromDays, int toDays, const int **slots);
+void queryTasks(Backend *b);
+int handleRequest(TaskStore *store, uint32_t op, const void *payload, uint32_t length, ReplyBuffer *out);
+int request(Backend *b, uint32_t op, const void *payload, uint32_t length, Reply *reply);
+void initSockets();
+SOCKET connectServer();
+int runServer(TaskStore *store);
+
+// todolist_bench.c defines TODOLIST_NO_MAIN to reuse everything else
+#ifndef TODOLIST_NO_MAIN
+int main(int argc, char *argv[]) {
+    TaskStore store;            // All tasks (unless a server has them)
+    Backend backend = {NULL, INVALID_SOCKET, {NULL, 0, 0}, NULL};
+    int choice;                 // User menu choice
+
+    initConsole();
+    initSockets();
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) return runServer(&store);
+
+    // With a server running this console is one of its clients; otherwise it has
+    // the tasks to itself, as before, if no other todolist has them
+    backend.server = connectServer();
+    if (backend.server == INVALID_SOCKET) {
+        initStore(&store);
+        int locked = recStoreLock(&store.files);
+        if (locked == 1) {
+            loadTasks(&store);  // Load saved tasks from file at program start
+            backend.store = &store;
+        } else {
+            freeStore(&store);
+            if (locked == 0) backend.server = connectServer();  // A server that was just starting
+            if (backend.server == INVALID_SOCKET) {
+                setColor(RED);
+                if (locked == 0)
+                    printf("tasks.dat is in use by another todolist. Close it first, or use todolist --server to share the tasks.\n");
+                else
+                    printf("Could not lock tasks.dat.\n");
+                setColor(RESET);
+                return 1;
+            }
+        }
+    }
+    if (backend.server != INVALID_SOCKET) {
+        setColor(GREEN);
+        printf("Connected to the task server (%s).\n", SERVER_SOCKET);
+        setColor(RESET);
+    }
+
+    do {
+        if (backend.store) autosave(&store);  // Save changes that have waited AUTOSAVE_SECONDS
+        printHeader();              // Print the stylized header
+
+        // Display menu options
+        setColor(BLUE);
+        printf("1. Add Task\n");
+        printf("2. View Tasks\n");
+        printf("3. Mark Task as Completed\n");
+        printf("4. Delete Task\n");
+        printf("5. Edit Task\n");
+        printf("6. Exit\n");
+        printf("7. Overdue / Due Soon\n");
+        setColor(YELLOW);
+        printf("Choose an option: ");
+        setColor(RESET);
+
+        scanf("%d", &choice);
+        getchar(); // Clear leftover newline from input buffer
+
+        // Execute action based on user's menu choice
+        switch (choice) {
+            case 1:
+                addTask(&backend);        // Add a new task
+                break;
+            case 2:
+                viewTasks(&backend);      // Display all tasks (with filtering)
+                break;
+            case 3:
+                completeTask(&backend);   // Mark a task as completed
+                break;
+            case 4:
+                deleteTask(&backend);     // Delete a task by ID
+                break;
+            case 5:
+                editTask(&backend);       // Edit an existing task
+                break;
+            case 6:
+                if (backend.store) {
+                    saveTasks(&store);  // Save all tasks to file before exiting
+                } else if (backend.server != INVALID_SOCKET) {
+                    closeSocket(backend.server);  // The server has saved everything already
+                }
+                setColor(GREEN);
+                printf("Exiting program...\n");
+                setColor(RESET);
+                break;
+            case 7:
+                queryTasks(&backend);     // Overdue and due-soon tasks
+                break;
+            default:
+                setColor(RED);
+                printf("Invalid choice. Try again.\n"); // Handle invalid input
+                setColor(RESET);
+        }
+    } while (choice != 6);  // Loop until user chooses to exit
+
+    if (backend.store) freeStore(&store);
+    free(backend.reply.data);
+    return 0;  // Successful program termination
+}
+#endif // TODOLIST_NO_MAIN
+
+
+// Decide once whether to use colors; on Windows this enables ANSI (VT) processing
+// in the console, so no console call is needed per color change
+void initConsole() {
+    if (!isatty(fileno(stdout))) return;  // Redirected: plain text
+#ifdef _WIN32
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) return;
+    useColor = SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+    useColor = 1;
+#endif
+}
+
+// ANSI escape sequence of a color code
+const char *ansiColor(int color) {
+    switch (color) {
+        case BLUE:    return "\033[94m";
+        case GREEN:   return "\033[92m";
+        case RED:     return "\033[91m";
+        case YELLOW:  return "\033[93m";
+        case MAGENTA: return "\033[95m";
+        case GRAY:    return "\033[90m";
+        default:      return "\033[0m";  // RESET
+    }
+}
+
+// Sets the text color (buffered in stdout like the text itself)
+void setColor(int color) {
+    if (useColor) fputs(ansiColor(color), stdout);
+}
+
+// Switch the color of the buffered text (only written if it changes)
+void renderColor(RenderBuffer *out, int color) {
+    if (!useColor || color == out->color) return;
+    out->color = color;
+    renderPrintf(out, "%s", ansiColor(color));
+}
+
+// Append formatted text to the buffer, growing it as needed
+void renderPrintf(RenderBuffer *out, const char *format, ...) {
+    va_list args;
+
+    for (;;) {
+        size_t room = out->capacity - out->length;
+        va_start(args, format);
+        int n = vsnprintf(out->data ? out->data + out->length : NULL, room, format, args);
+        va_end(args);
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            out->length += n;
+            return;
+        }
+
+        size_t capacity = out->capacity ? out->capacity * 2 : 4096;
+        while (capacity - out->length <= (size_t)n) capacity *= 2;
+        char *data = realloc(out->data, capacity);
+        if (!data) return;  // Out of memory: the text is dropped
+        out->data = data;
+        out->capacity = capacity;
+    }
+}
+
+// Write the buffer with one call and empty it
+void renderFlush(RenderBuffer *out) {
+    fflush(stdout);  // Prompts printed before the table come first
+    fwrite(out->data, 1, out->length, stdout);
+    fflush(stdout);
+    out->length = 0;
+}
+
+// Prints a styled header at the top of the menu
+void printHeader() {
+    setColor(BLUE);  // Set text color to blue
+    printf("\n***************************************\n");
+    printf("*        Stylish To-Do List Menu       *\n");
+    printf("***************************************\n");
+    setColor(RESET); // Reset to default console color
+}
+
+
+
+// Adds a new task to the task list
+void addTask(Backend *b) {
+    Task newTask;
+    Reply reply;
+    memset(&newTask, 0, sizeof(newTask));
+
+    // Prompt and read task description
+    setColor(YELLOW);
+    printf("Enter task description: ");
+    setColor(RESET);
+    fgets(newTask.description, MAX_LENGTH, stdin);
+    newTask.description[strcspn(newTask.description, "\n")] = '\0';  // Remove trailing newline
+
+    // Prompt and read deadline
+    printf("Enter deadline (e.g., 2025-06-30): ");
+    fgets(newTask.deadline, 20, stdin);
+    newTask.deadline[strcspn(newTask.deadline, "\n")] = '\0';
+
+    // Prompt and read priority (1-High, 2-Medium, 3-Low)
+    printf("Enter priority (1 = High, 2 = Medium, 3 = Low): ");
+    scanf("%d", &newTask.priority);
+    getchar();  // Clear newline from buffer
+
+    // Prompt and read task category
+    setColor(YELLOW);
+    printf("Enter category [");
+    if (request(b, REQ_CATEGORIES, NULL, 0, &reply) == REPLY_OK) {
+        const CategoryRow *categories = (const CategoryRow *)b->items;
+        for (int c = 0; c < reply.count; c++) printf("%s%s", c ? ", " : "", categories[c].name);
+    }
+    printf(", or a new one]: ");
+    setColor(RESET);
+    fgets(newTask.category, 20, stdin);
+    newTask.category[strcspn(newTask.category, "\n")] = '\0';
+    if (newTask.category[0] == '\0') strcpy(newTask.category, "Other");
+
+    // Initialize task as not completed (the ID is given by handleRequest)
+    newTask.completed = 0;
+
+    // Journal the new task, then add it to the store
+    if (request(b, OP_ADD, &newTask, sizeof(newTask), &reply) != REPLY_OK) {
+        setColor(RED);
+        printf("Could not add the task.\n");
+        setColor(RESET);
+        return;
+    }
+
+    setColor(GREEN);
+    printf(" Task %d added successfully.\n", reply.id);
+    setColor(RESET);
+}
+
+
+// Column headers of the task table
+static void renderTaskHeader(RenderBuffer *out) {
+    renderColor(out, BLUE);
+    renderPrintf(out, "\n%-5s %-30s %-12s %-10s %-10s %-12s %-10s\n",
+                 "ID", "Description", "Deadline", "Priority", "Status", "Category", "Due In");
+}
+
+// One row of the task table; categoryColor is the color of its interned category
+static void renderTaskRow(RenderBuffer *out, const Task *t, int categoryColor, int today) {
+    // Days remaining until the deadline
+    int daysRemaining = t->deadlineDays - today;
+    int hasDeadline = t->deadlineDays != NO_DEADLINE;
+    char dayStr[20];
+    if (t->completed || !hasDeadline)
+        strcpy(dayStr, "—");  // Not applicable for completed tasks or unreadable dates
+    else if (daysRemaining < 0)
+        strcpy(dayStr, "Overdue");  // Task is overdue
+    else
+        sprintf(dayStr, "%d days", daysRemaining);  // Days left
+
+    // Highlight overdue tasks in red
+    int isOverdue = (!t->completed && hasDeadline && daysRemaining < 0);
+    renderColor(out, isOverdue ? RED : RESET);
+
+    // Print description and deadline
+    renderPrintf(out, "%-5d %-30s %-12s ", t->id, t->description, t->deadline);
+
+    // Print and color-code priority
+    switch (t->priority) {
+        case 1: renderColor(out, RED);     renderPrintf(out, "%-10s ", "High"); break;
+        case 2: renderColor(out, YELLOW);  renderPrintf(out, "%-10s ", "Medium"); break;
+        case 3: renderColor(out, MAGENTA); renderPrintf(out, "%-10s ", "Low"); break;
+        default: renderColor(out, RESET);  renderPrintf(out, "%-10s ", "Unknown");
+    }
+
+    // Print completion status
+    renderColor(out, t->completed ? GREEN : RED);
+    renderPrintf(out, "%-10s ", t->completed ? " Done" : "Open");
+
+    // Print category with the color of its interned entry
+    renderColor(out, categoryColor);
+    renderPrintf(out, "%-12s ", t->category);
+
+    // Print "due in" info
+    renderColor(out, isOverdue ? RED : RESET);
+    renderPrintf(out, "%-10s\n", dayStr);
+}
+
+// The rows of a REQ_LIST or REQ_QUERY reply
+static void renderTaskRows(RenderBuffer *out, Backend *b, const Reply *reply, int today) {
+    const TaskRow *rows = (const TaskRow *)b->items;
+    for (int k = 0; k < reply->count; k++) renderTaskRow(out, &rows[k].task, rows[k].color, today);
+}
+
+// Displays all tasks, optionally filtered by category, in deadline order
+void viewTasks(Backend *b) {
+    ListRequest list = {-1, 0, 0, 0, 0};
+    Reply reply;
+
+    if (request(b, REQ_LIST, &list, sizeof(list), &reply) != REPLY_OK) return;
+    if (reply.total == 0) {
+        // No tasks to show
+        setColor(RED);
+        printf("No tasks to show.\n");
+        setColor(RESET);
+        return;
+    }
+
+    // Ask user to choose a filter by category
+    if (request(b, REQ_CATEGORIES, NULL, 0, &reply) != REPLY_OK) return;
+    const CategoryRow *categories = (const CategoryRow *)b->items;
+    int categoryCount = reply.count;
+    setColor(YELLOW);
+    printf("\nView Options:\n");
+    for (int c = 0; c < categoryCount; c++) printf("%d. %s\n", c + 1, categories[c].name);
+    printf("%d. All\nChoose filter: ", categoryCount + 1);
+    setColor(RESET);
+
+    int filterChoice;
+    scanf("%d", &filterChoice);
+    getchar();  // Clear newline from buffer
+
+    // A category shows its own list of tasks, "All" the ordered index of every task
+    if (filterChoice >= 1 && filterChoice <= categoryCount) {
+        list.category = filterChoice - 1;
+    } else if (filterChoice != categoryCount + 1) {
+        // Invalid choice, fallback to showing all
+        setColor(RED);
+        printf("Invalid choice. Showing all tasks.\n");
+        setColor(RESET);
+    }
+
+    RenderBuffer out = {NULL, 0, 0, -1};
+    int today = todayDays();
+    list.limit = PAGE_ROWS;
+
+    // Fetch one page of the ordered list at a time; the tasks come out soonest deadline first
+    for (int page = 0; ; ) {
+        list.offset = page * PAGE_ROWS;
+        if (request(b, REQ_LIST, &list, sizeof(list), &reply) != REPLY_OK) break;
+        int pages = reply.total > 0 ? (reply.total + PAGE_ROWS - 1) / PAGE_ROWS : 1;
+
+        renderTaskHeader(&out);
+        renderTaskRows(&out, b, &reply, today);
+        renderColor(&out, RESET);
+        renderFlush(&out);
+
+        // Nothing more to ask on the last page of a single-page list
+        if (pages == 1) break;
+
+        char answer[16] = "";
+        setColor(YELLOW);
+        printf("Page %d of %d. Enter = next page, p = previous, q = back to menu: ", page + 1, pages);
+        setColor(RESET);
+        if (!fgets(answer, sizeof(answer), stdin) || answer[0] == 'q') break;
+        if (answer[0] == 'p') {
+            if (page > 0) page--;
+        } else if (page + 1 < pages) {
+            page++;
+        } else {
+            break;
+        }
+    }
+    free(out.data);
+}
+
+// Shows the overdue tasks and the tasks due in the next N days
+void queryTasks(Backend *b) {
+    Reply reply;
+    int days;
+
+    setColor(YELLOW);
+    printf("Show tasks due within how many days? ");
+    setColor(RESET);
+    if (scanf("%d", &days) != 1 || days < 0) days = 0;
+    getchar();  // Clear newline from buffer
+
+    RenderBuffer out = {NULL, 0, 0, -1};
+    int today = todayDays();
+
+    // Overdue: every open task with a deadline before today
+    ListRequest query = {-1, INT_MIN, today - 1, 0, INT_MAX};
+    if (request(b, REQ_QUERY, &query, sizeof(query), &reply) != REPLY_OK) return;
+    renderColor(&out, RED);
+    renderPrintf(&out, "\nOverdue: %d\n", reply.total);
+    if (reply.count > 0) renderTaskHeader(&out);
+    renderTaskRows(&out, b, &reply, today);
+
+    query.fromDays = today;
+    query.toDays = days > INT_MAX - today ? INT_MAX : today + days;
+    if (request(b, REQ_QUERY, &query, sizeof(query), &reply) == REPLY_OK) {
+        renderColor(&out, YELLOW);
+        renderPrintf(&out, "\nDue in the next %d days: %d\n", days, reply.total);
+        if (reply.count > 0) renderTaskHeader(&out);
+        renderTaskRows(&out, b, &reply, today);
+    }
+
+    renderColor(&out, RESET);
+    renderFlush(&out);
+    free(out.data);
+}
+
+// Tells the user why a change was refused; returns 1 if it was made
+static int changeMade(const Reply *reply) {
+    if (reply->status == REPLY_OK) return 1;
+    setColor(RED);
+    if (reply->status == REPLY_NOT_FOUND) printf("Invalid task ID!\n");  // Error if there is no such task
+    else printf("The change could not be made.\n");
+    setColor(RESET);
+    return 0;
+}
+
+// Marks a specific task as completed based on user input
+void completeTask(Backend *b) {
+    Reply reply;
+    int id;
+
+    // Prompt the user for the ID of the task to mark as completed
+    setColor(YELLOW);
+    printf("Enter task ID to mark as completed: ");
+    setColor(RESET);
+    scanf("%d", &id);
+
+    // Mark the corresponding task as completed (an unknown ID is refused)
+    request(b, OP_COMPLETE_TASK, &id, sizeof(id), &reply);
+    if (!changeMade(&reply)) return;
+
+    // Confirm to user
+    setColor(GREEN);
+    printf("Task marked as completed.\n");
+    setColor(RESET);
+}
+
+
+// Deletes a task from the list based on the user's input
+void deleteTask(Backend *b) {
+    Reply reply;
+    int id;
+
+    // Prompt user to enter the ID of the task they want to delete
+    setColor(YELLOW);
+    printf("Enter task ID to delete: ");
+    setColor(RESET);
+    scanf("%d", &id);
+
+    // Remove the task (its slot goes on the free list)
+    request(b, OP_DELETE_TASK, &id, sizeof(id), &reply);
+    if (!changeMade(&reply)) return;
+
+    // Notify the user of successful deletion
+    setColor(GREEN);
+    printf("Task deleted.\n");
+    setColor(RESET);
+}
+
+// The record of a slot in tasks.dat: the task, or all zeros for a free slot
+static const void *taskRecord(long row, void *buffer, void *ctx) {
+    static const Task freeSlot;
+    const Task *t = taskAt(ctx, (int)row);
+    (void)buffer;
+    return t->id > 0 ? t : &freeSlot;
+}
+
+static long taskRows(void *ctx) {
+    return ((TaskStore *)ctx)->used;
+}
+
+// Saves the tasks to a binary file for persistence between sessions: only the
+// changed slots, or the whole file when it does not match the store
+void saveTasks(TaskStore *store) {
+    // If the file couldn't be written, print error
+    if (!recStoreCheckpoint(&store->files)) {
+        setColor(RED);
+        printf("Failed to save tasks.\n");
+        setColor(RESET);
+    }
+}
+
+// Saves the pending changes once CHECKPOINT_EVERY have piled up or the oldest has
+// waited AUTOSAVE_SECONDS
+void autosave(TaskStore *store) {
+    if (recStoreDue(&store->files)) saveTasks(store);
+}
+
+
+// Never trust the strings in a file or journal to be terminated
+static void terminateTask(Task *t) {
+    t->description[MAX_LENGTH - 1] = '\0';
+    t->deadline[sizeof(t->deadline) - 1] = '\0';
+    t->category[sizeof(t->category) - 1] = '\0';
+}
+
+// Copies a task of the current or an older, shorter size (at least TASK_V1_SIZE; the
+// missing fields are zero) and works out its deadlineDays
+static int copyTask(Task *t, const void *data, size_t size) {
+    if (size < TASK_V1_SIZE || size > sizeof(Task)) return 0;
+    memset(t, 0, sizeof(Task));
+    memcpy(t, data, size);
+    terminateTask(t);
+    setDeadlineDays(t);
+    return 1;
+}
+
+// Adds one task from the file to the store (called by recFileLoad).
+// The order index is built once everything is loaded.
+static int loadTask(const void *record, long index, void *ctx) {
+    TaskStore *store = ctx;
+    int id;
+
+    // An all-zero record is a free slot: it keeps its place (see rebuildFreeList)
+    static const Task freeSlot;
+    int slot;
+    if (memcmp(record, &freeSlot, sizeof(Task)) == 0) {
+        slot = allocSlot(store);
+        if (slot >= 0) taskAt(store, slot)->id = 0;
+    } else {
+        memcpy(&id, (const char *)record + offsetof(Task, id), sizeof(id));
+        slot = storeAdd(store, record, sizeof(Task), 0);
+        if (slot >= 0 && taskAt(store, slot)->id != id) store->renumbered++;
+    }
+
+    if (slot < 0) store->dropped++;
+    if (slot != index) store->misplaced++;
+    return 1;
+}
+
+// Puts the free slots of a loaded file on the free list, lowest slot first
+static void rebuildFreeList(TaskStore *store) {
+    store->freeHead = -1;
+    for (int slot = store->used - 1; slot >= 0; slot--) {
+        if (taskAt(store, slot)->id > 0) continue;
+        store->nextFree[slot] = store->freeHead;
+        store->freeHead = slot;
+    }
+}
+
+// Reads a tasks.dat of the old format: an int count followed by the raw tasks
+static int loadLegacyTasks(const char *path, void *ctx) {
+    TaskStore *store = ctx;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    // The count must match the size of the file
+    int count = 0;
+    long size = 0;
+    if (fread(&count, sizeof(int), 1, fp) == 1 && fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    int ok = count >= 0 &&
+             size == (long)sizeof(int) + (long)count * (long)TASK_V1_SIZE &&
+             fseek(fp, sizeof(int), SEEK_SET) == 0;
+
+    // The old file holds tasks of the old size, without deadlineDays or an ID
+    unsigned char record[sizeof(Task)];
+    for (int i = 0; ok && i < count; i++) {
+        ok = fread(record, TASK_V1_SIZE, 1, fp) == 1;
+        if (ok && storeAdd(store, record, TASK_V1_SIZE, 0) < 0) store->dropped++;
+    }
+    fclose(fp);
+
+    store->renumbered = store->count;
+    return ok;
+}
+
+
+// Applies a new or replayed change (called by the record store)
+static int applyTask(uint32_t op, const void *payload, uint32_t length, void *ctx) {
+    return applyChange(ctx, op, payload, length);
+}
+
+// How tasks are kept in tasks.dat and tasks.jnl (Common/code/recstore.h)
+static const RecSchema taskSchema = {
+    SAVE_FILE, JOURNAL_FILE, RECTYPE_TASK, sizeof(Task),
+    JOURNAL_SYNC_EVERY, CHECKPOINT_EVERY, AUTOSAVE_SECONDS,
+    loadTask, loadLegacyTasks, applyTask, taskRows, taskRecord
+};
+
+// Loads tasks from a binary file into memory at program startup,
+// then applies the changes journaled since it was last saved
+void loadTasks(TaskStore *store) {
+    int status = recStoreLoad(&store->files);
+
+    // A missing file means a first run; anything else worth telling the user about
+    setColor(RED);
+    if (status == RECFILE_CORRUPT) {
+        printf("tasks.dat is damaged: %ld tasks could not be read.\n", store->files.lostRecords);
+    } else if (status == RECFILE_BAD_HEADER) {
+        printf("tasks.dat could not be read. A new file is started.\n");
+    } else if (status == RECFILE_IO_ERROR) {
+        printf("tasks.dat could not be read. Nothing was changed.\n");
+        exit(1);
+    }
+    if (store->dropped > 0)
+        printf("Out of memory: %d tasks could not be loaded.\n", store->dropped);
+    setColor(RESET);
+
+    // Changed slots can be written in place only if tasks.dat matches the slots exactly
+    if (store->dropped > 0 || store->misplaced > 0 || store->renumbered > 0) store->files.rewrite = 1;
+    rebuildFreeList(store);
+
+    // Missing IDs are given in file order, so a file written before IDs gets the same
+    // ones every time it is loaded, until the next checkpoint stores them
+    if (!rebuildOrder(store)) {
+        setColor(RED);
+        printf("Out of memory: the task list could not be ordered.\n");
+        setColor(RESET);
+    }
+
+    // Replays the journal and checkpoints what it replayed
+    int opened = recStoreReplay(&store->files);
+    setColor(RED);
+    if (store->files.skipped > 0)
+        printf("%ld changes in %s could not be applied and were skipped.\n", store->files.skipped, JOURNAL_FILE);
+    if (!opened)
+        printf("Could not open the journal %s. Changes are saved on exit only.\n", JOURNAL_FILE);
+    if (store->files.backupPath[0])
+        printf("The damaged file is kept as %s\n", store->files.backupPath);
+    setColor(RESET);
+}
+
+
+// Applies one change to the task list; returns 1 if it was valid
+int applyChange(TaskStore *store, uint32_t op, const void *payload, uint32_t length) {
+    int slot = -1;
+    if ((op == OP_COMPLETE_TASK || op == OP_DELETE_TASK) && length == sizeof(int)) {
+        int id;
+        memcpy(&id, payload, sizeof(int));
+        slot = findTask(store, id);
+    }
+
+    switch (op) {
+        case OP_ADD:
+        case OP_EDIT_TASK: {
+            Task task;
+            if (!copyTask(&task, payload, length)) return 0;
+            slot = findTask(store, task.id);
+            // IDs are never reused, so an added task that is already there was saved
+            // before a crash: replaying it again replaces it, like an edit
+            if (op == OP_ADD && slot < 0) return storeAdd(store, payload, length, 1) >= 0;
+            if (slot < 0) return 0;
+            // The deadline, priority or category may have changed: take the task out of the
+            // order and put it back (it has a place in its old lists if the new one is full)
+            Task old = *taskAt(store, slot);
+            int oldCategory = store->categoryOf[slot];
+            int category = internCategory(store, task.category);
+            if (category < 0) return 0;
+
+            orderRemove(store, slot);
+            *taskAt(store, slot) = task;
+            store->categoryOf[slot] = category;
+            markDirty(store, slot);
+            if (orderInsert(store, slot)) return 1;
+
+            *taskAt(store, slot) = old;
+            store->categoryOf[slot] = oldCategory;
+            orderInsert(store, slot);
+            return 0;
+        }
+        case OP_COMPLETE_TASK:
+            if (slot < 0) return 0;
+            markCompleted(store, slot);
+            return 1;
+        case OP_DELETE_TASK:
+            if (slot >= 0) storeRemove(store, slot);
+            return 1;  // A task that is already gone was deleted before a crash
+    }
+    return 0;
+}
+
+
+// Journals a change and then applies it; returns 1 on success.
+// Without a working journal the change is still made and saved on exit.
+int logChange(TaskStore *store, uint32_t op, const void *payload, uint32_t length) {
+    int result = recStoreChange(&store->files, op, payload, length);
+    if (result == RECSTORE_JOURNAL_FAILED) {
+        setColor(RED);
+        printf("Could not write the journal. Change not made.\n");
+        setColor(RESET);
+        return 0;
+    }
+    if (!result) return 0;
+
+    autosave(store);
+    return 1;
+}
+
+
+// Makes room for length more bytes in a reply buffer; returns 1 on success
+static int replyReserve(ReplyBuffer *out, size_t length) {
+    if (out->capacity - out->length >= length) return 1;
+
+    size_t capacity = out->capacity ? out->capacity : 4096;
+    while (capacity - out->length < length) capacity *= 2;
+    char *data = realloc(out->data, capacity);
+    if (!data) return 0;
+    out->data = data;
+    out->capacity = capacity;
+    return 1;
+}
+
+static int replyAppend(ReplyBuffer *out, const void *data, size_t length) {
+    if (!replyReserve(out, length)) return 0;
+    memcpy(out->data + out->length, data, length);
+    out->length += length;
+    return 1;
+}
+
+// Adds the task in a slot to a reply, with the color of its category
+static int replyTask(ReplyBuffer *out, TaskStore *store, int slot) {
+    TaskRow row;
+    row.task = *taskAt(store, slot);
+    row.color = store->categories[store->categoryOf[slot]].color;
+    return replyAppend(out, &row, sizeof(row));
+}
+
+// Answers one request: a change (the journal operations) or a read (REQ_*). The reply
+// is appended to out. Used by the server for its clients and by the console directly
+// when it runs alone, so both behave the same. Returns 0 if out could not grow.
+int handleRequest(TaskStore *store, uint32_t op, const void *payload, uint32_t length, ReplyBuffer *out) {
+    Reply reply = {REPLY_OK, 0, 0, 0, 0};
+    size_t start = out->length;
+    Task task;
+    ListRequest list;
+    int id, ok = 1;
+
+    if (!replyAppend(out, &reply, sizeof(reply))) return 0;
+
+    switch (op) {
+        case OP_ADD:
+            if (!copyTask(&task, payload, length)) {
+                reply.status = REPLY_BAD_REQUEST;
+                break;
+            }
+            // IDs are given here, so every client gets its own and the journal has the real one
+            task.id = store->nextId;
+            if (!logChange(store, OP_ADD, &task, sizeof(task))) reply.status = REPLY_FAILED;
+            else reply.id = task.id;
+            break;
+        case REQ_EDIT: {
+            TaskEdit edit;
+            if (length != sizeof(edit)) {
+                reply.status = REPLY_BAD_REQUEST;
+                break;
+            }
+            memcpy(&edit, payload, sizeof(edit));
+            edit.description[sizeof(edit.description) - 1] = '\0';
+            edit.deadline[sizeof(edit.deadline) - 1] = '\0';
+            reply.id = edit.id;
+            int slot = findTask(store, edit.id);
+            if (slot < 0) {
+                reply.status = REPLY_NOT_FOUND;
+                break;
+            }
+
+            // The edited fields on the task as it is now; the whole task is journaled
+            task = *taskAt(store, slot);
+            if (edit.description[0]) strcpy(task.description, edit.description);
+            if (edit.deadline[0]) strcpy(task.deadline, edit.deadline);
+            if (edit.priority >= 1 && edit.priority <= 3) task.priority = edit.priority;
+            setDeadlineDays(&task);
+            if (!logChange(store, OP_EDIT_TASK, &task, sizeof(task))) reply.status = REPLY_FAILED;
+            break;
+        }
+        case OP_COMPLETE_TASK:
+        case OP_DELETE_TASK:
+        case REQ_GET: {
+            if (length != sizeof(id)) {
+                reply.status = REPLY_BAD_REQUEST;
+                break;
+            }
+            memcpy(&id, payload, sizeof(id));
+            reply.id = id;
+            int slot = findTask(store, id);
+            if (slot < 0) {
+                reply.status = REPLY_NOT_FOUND;
+            } else if (op == REQ_GET) {
+                ok = replyTask(out, store, slot);
+                reply.count = reply.total = 1;
+            } else if (!logChange(store, op, &id, sizeof(id))) {
+                reply.status = REPLY_FAILED;
+            }
+            break;
+        }
+        case REQ_LIST:
+        case REQ_QUERY: {
+            const int *slots = NULL;
+            int total = 0;
+            if (length != sizeof(list)) {
+                reply.status = REPLY_BAD_REQUEST;
+                break;
+            }
+            memcpy(&list, payload, sizeof(list));
+
+            // Every list is already in display order: a page is a slice of it
+            if (op == REQ_QUERY) {
+                total = queryDeadlines(store, list.fromDays, list.toDays, &slots);
+            } else if (list.category < 0) {
+                slots = store->order.slots;
+                total = store->order.count;
+            } else if (list.category < store->categoryCount) {
+                slots = store->categories[list.category].tasks.slots;
+                total = store->categories[list.category].tasks.count;
+            } else {
+                reply.status = REPLY_NOT_FOUND;
+                break;
+            }
+
+            int first = list.offset < 0 ? 0 : list.offset < total ? list.offset : total;
+            int count = list.limit < 0 ? 0 : list.limit < total - first ? list.limit : total - first;
+            for (int k = first; ok && k < first + count; k++) ok = replyTask(out, store, slots[k]);
+            reply.count = count;
+            reply.total = total;
+            break;
+        }
+        case REQ_CATEGORIES:
+            for (int c = 0; ok && c < store->categoryCount; c++) {
+                CategoryRow row;
+                memset(&row, 0, sizeof(row));
+                memcpy(row.name, store->categories[c].name, sizeof(row.name));
+                row.color = store->categories[c].color;
+                ok = replyAppend(out, &row, sizeof(row));
+            }
+            reply.count = reply.total = store->categoryCount;
+            break;
+        default:
+            reply.status = REPLY_BAD_REQUEST;
+    }
+
+    // Out of memory halfway through a list: send no items rather than some of them
+    if (!ok) {
+        out->length = start + sizeof(reply);
+        reply.status = REPLY_FAILED;
+        reply.count = 0;
+    }
+    reply.bytes = (uint32_t)(out->length - start - sizeof(reply));
+    memcpy(out->data + start, &reply, sizeof(reply));
+    return 1;
+}
+
+
+// Sends all of data; returns 0 if the connection is gone
+static int sendAll(SOCKET s, const void *data, size_t length) {
+    const char *p = data;
+    while (length > 0) {
+        int n = send(s, p, length > 65536 ? 65536 : (int)length, 0);
+        if (n <= 0) return 0;
+        p += n;
+        length -= n;
+    }
+    return 1;
+}
+
+// Receives exactly length bytes; returns 0 if the connection is gone
+static int recvAll(SOCKET s, void *data, size_t length) {
+    char *p = data;
+    while (length > 0) {
+        int n = recv(s, p, length > 65536 ? 65536 : (int)length, 0);
+        if (n <= 0) return 0;
+        p += n;
+        length -= n;
+    }
+    return 1;
+}
+
+// Sends a request to the store and waits for the reply. The items of the reply are
+// at b->items and stay valid until the next request. Returns reply->status.
+int request(Backend *b, uint32_t op, const void *payload, uint32_t length, Reply *reply) {
+    b->reply.length = 0;
+    b->items = NULL;
+
+    // Alone: the same handler the server uses, on the store of this process
+    if (b->store) {
+        if (!handleRequest(b->store, op, payload, length, &b->reply)) {
+            memset(reply, 0, sizeof(*reply));
+            reply->status = REPLY_FAILED;
+            return reply->status;
+        }
+        memcpy(reply, b->reply.data, sizeof(*reply));
+        b->items = b->reply.data + sizeof(*reply);
+        return reply->status;
+    }
+
+    // Header and payload go out in one send, so the request is not held back by Nagle
+    unsigned char message[sizeof(RequestHeader) + JOURNAL_MAX_PAYLOAD];
+    RequestHeader header = {length, op};
+    if (length > JOURNAL_MAX_PAYLOAD) {
+        memset(reply, 0, sizeof(*reply));
+        reply->status = REPLY_BAD_REQUEST;
+        return reply->status;
+    }
+    memcpy(message, &header, sizeof(header));
+    if (length > 0) memcpy(message + sizeof(header), payload, length);
+
+    if (b->server != INVALID_SOCKET && sendAll(b->server, message, sizeof(header) + length) &&
+        recvAll(b->server, reply, sizeof(*reply)) &&
+        replyReserve(&b->reply, reply->bytes) && recvAll(b->server, b->reply.data, reply->bytes)) {
+        b->items = b->reply.data;
+        return reply->status;
+    }
+
+    // The server stopped: every later request fails the same way
+    if (b->server != INVALID_SOCKET) {
+        closeSocket(b->server);
+        b->server = INVALID_SOCKET;
+        setColor(RED);
+        printf("Lost the connection to the task server.\n");
+        setColor(RESET);
+    }
+    memset(reply, 0, sizeof(*reply));
+    reply->status = REPLY_FAILED;
+    return reply->status;
+}
+
+
+// Socket setup: Winsock needs to be started once; elsewhere a client that went away
+// must not kill the process with SIGPIPE
+void initSockets() {
+#ifdef _WIN32
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+}
+
+static struct sockaddr_un serverAddress() {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SERVER_SOCKET);
+    return address;
+}
+
+// Connects to a running todolist --server; INVALID_SOCKET if there is none
+SOCKET connectServer() {
+    struct sockaddr_un address = serverAddress();
+    SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return INVALID_SOCKET;
+    if (connect(s, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        closeSocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+// Only the account running the server may open the socket (and so read or change the
+// tasks); returns 1 on success
+static int ownerOnly(const char *path) {
+#ifdef _WIN32
+    // A DACL with one entry, for this user, in place of the inherited ones
+    DWORD user[64];  // TOKEN_USER and its SID
+    DWORD size;
+    HANDLE token;
+    PACL acl = NULL;
+    int ok = 0;
+
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) return 0;
+    if (GetTokenInformation(token, TokenUser, user, sizeof(user), &size)) {
+        EXPLICIT_ACCESSA access;
+        memset(&access, 0, sizeof(access));
+        access.grfAccessPermissions = GENERIC_ALL;
+        access.grfAccessMode = SET_ACCESS;
+        access.grfInheritance = NO_INHERITANCE;
+        access.Trustee.TrusteeForm = TRUSTEE_IS_SID;
+        access.Trustee.TrusteeType = TRUSTEE_IS_USER;
+        access.Trustee.ptstrName = (LPSTR)((TOKEN_USER *)user)->User.Sid;
+        ok = SetEntriesInAclA(1, &access, NULL, &acl) == ERROR_SUCCESS &&
+             SetNamedSecurityInfoA((LPSTR)path, SE_FILE_OBJECT,
+                                   DACL_SECURITY_INFORMATION | PROTECTED_DACL_SECURITY_INFORMATION,
+                                   NULL, NULL, acl, NULL) == ERROR_SUCCESS;
+        if (acl) LocalFree(acl);
+    }
+    CloseHandle(token);
+    return ok;
+#else
+    return chmod(path, 0600) == 0;
+#endif
+}
+
+static SOCKET listenServer() {
+    struct sockaddr_un address = serverAddress();
+    SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return INVALID_SOCKET;
+
+    // A socket file left by a server that crashed: this process holds the lock of the
+    // files, so no other server is using it
+    remove(SERVER_SOCKET);
+#ifdef _WIN32
+    int bound = bind(s, (struct sockaddr *)&address, sizeof(address)) == 0;
+#else
+    mode_t mask = umask(077);  // Owner-only from the start, not only after the chmod
+    int bound = bind(s, (struct sockaddr *)&address, sizeof(address)) == 0;
+    umask(mask);
+#endif
+    if (!bound || !ownerOnly(SERVER_SOCKET) || listen(s, 16) != 0) {
+        closeSocket(s);
+        if (bound) remove(SERVER_SOCKET);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+// Ctrl+C stops the server after the current round (checked between selects)
+static volatile sig_atomic_t serverStopping = 0;
+
+static void stopServer(int signo) {
+    (void)signo;
+    serverStopping = 1;
+}
+
+// 1 if a call on a non-blocking socket failed only because it would have to wait
+static int socketBusy() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+// Client sockets never block the server: a console that does not read its replies
+// only fills its own queue
+static int setNonBlocking(SOCKET s) {
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket(s, FIONBIO, &on) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// Reads what a client sent and answers every complete request in it; returns 0 if
+// the client went away or sent garbage
+static int readClient(TaskStore *store, Client *c) {
+    int n = recv(c->fd, (char *)c->in + c->inLength, (int)(sizeof(c->in) - c->inLength), 0);
+    if (n < 0 && socketBusy()) return 1;
+    if (n <= 0) return 0;
+    c->inLength += n;
+
+    size_t used = 0;
+    while (c->inLength - used >= sizeof(RequestHeader)) {
+        RequestHeader header;
+        memcpy(&header, c->in + used, sizeof(header));
+        if (header.length > JOURNAL_MAX_PAYLOAD) return 0;  // Could never fit in the buffer
+        if (c->inLength - used < sizeof(header) + header.length) break;  // Rest not here yet
+
+        if (!handleRequest(store, header.op, c->in + used + sizeof(header), header.length, &c->out))
+            return 0;
+        used += sizeof(header) + header.length;
+    }
+    memmove(c->in, c->in + used, c->inLength - used);
+    c->inLength -= used;
+    return 1;
+}
+
+// Sends as much of the queued replies as the client takes without waiting; returns 0
+// if it went away or has left more than MAX_CLIENT_OUTPUT unread
+static int writeClient(Client *c) {
+    while (c->sent < c->out.length) {
+        size_t left = c->out.length - c->sent;
+        int n = send(c->fd, c->out.data + c->sent, left > 65536 ? 65536 : (int)left, 0);
+        if (n < 0 && socketBusy()) break;
+        if (n <= 0) return 0;
+        c->sent += n;
+    }
+
+    // Keep only what is still to be sent
+    memmove(c->out.data, c->out.data + c->sent, c->out.length - c->sent);
+    c->out.length -= c->sent;
+    c->sent = 0;
+    return c->out.length <= MAX_CLIENT_OUTPUT;
+}
+
+// todolist --server: one process owns tasks.dat and the journal (it holds their lock
+// file, tasks.dat.lock) and serves every console of its account over the local
+// socket SERVER_SOCKET. It is a single-threaded select loop, so requests are handled
+// one at a time and reads need no locks. The changes of one round (all the requests
+// that arrived together) are journaled as one batch with a single fsync, and their
+// replies go out only after that sync. Client sockets are non-blocking: replies wait
+// in a queue per client until the client reads them.
+int runServer(TaskStore *store) {
+    // The files are the server's alone while it runs (a console on its own has them locked)
+    initStore(store);
+    int locked = recStoreLock(&store->files);
+    if (locked != 1) {
+        setColor(RED);
+        if (locked == 0) printf("tasks.dat is in use by another todolist (is a server already running?)\n");
+        else printf("Could not lock tasks.dat.\n");
+        setColor(RESET);
+        freeStore(store);
+        return 1;
+    }
+
+    SOCKET listener = listenServer();
+    if (listener == INVALID_SOCKET) {
+        setColor(RED);
+        printf("Could not create the socket %s.\n", SERVER_SOCKET);
+        setColor(RESET);
+        freeStore(store);
+        return 1;
+    }
+
+    Client *clients = calloc(MAX_CLIENTS, sizeof(Client));
+    if (!clients) {
+        closeSocket(listener);
+        freeStore(store);
+        return 1;
+    }
+    int clientCount = 0;
+
+    loadTasks(store);
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+
+    setColor(GREEN);
+    printf("Task server listening on %s (%d tasks). Press Ctrl+C to stop.\n",
+           SERVER_SOCKET, store->count);
+    setColor(RESET);
+    fflush(stdout);
+
+    while (!serverStopping) {
+        fd_set readable, writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(listener, &readable);
+        SOCKET maxFd = listener;
+        for (int i = 0; i < clientCount; i++) {
+            FD_SET(clients[i].fd, &readable);
+            if (clients[i].out.length > 0) FD_SET(clients[i].fd, &writable);
+            if (clients[i].fd > maxFd) maxFd = clients[i].fd;
+        }
+
+        // Wake up every second for the autosave and Ctrl+C
+        struct timeval timeout = {1, 0};
+        int ready = select((int)maxFd + 1, &readable, &writable, NULL, &timeout);
+        if (ready < 0) {
+#ifndef _WIN32
+            if (errno == EINTR) continue;
+#endif
+            break;
+        }
+
+        if (ready > 0) {
+            if (FD_ISSET(listener, &readable)) {
+                SOCKET s = accept(listener, NULL, NULL);
+                if (s != INVALID_SOCKET && clientCount < MAX_CLIENTS && setNonBlocking(s)) {
+                    memset(&clients[clientCount], 0, sizeof(Client));
+                    clients[clientCount++].fd = s;
+                } else if (s != INVALID_SOCKET) {
+                    closeSocket(s);  // Full: the console runs without the server's tasks
+                }
+            }
+
+            // Group commit: one journal sync for all the changes of this round
+            journalBeginBatch(&store->files.journal);
+            for (int i = 0; i < clientCount; i++)
+                if (FD_ISSET(clients[i].fd, &readable) && !readClient(store, &clients[i]))
+                    clients[i].closed = 1;
+            if (store->files.journal.fp && !journalEndBatch(&store->files.journal)) {
+                setColor(RED);
+                printf("Could not sync the journal %s.\n", JOURNAL_FILE);
+                setColor(RESET);
+            }
+
+            // Only now are the changes durable: send the replies, to every client that
+            // takes them right away; the rest stay queued for the next rounds
+            for (int i = 0; i < clientCount; ) {
+                Client *c = &clients[i];
+                if (!c->closed && c->out.length > 0 && !writeClient(c)) c->closed = 1;
+                if (!c->closed) {
+                    i++;
+                    continue;
+                }
+                closeSocket(c->fd);
+                free(c->out.data);
+                clients[i] = clients[--clientCount];
+            }
+        }
+        autosave(store);
+    }
+
+    for (int i = 0; i < clientCount; i++) {
+        closeSocket(clients[i].fd);
+        free(clients[i].out.data);
+    }
+    free(clients);
+    closeSocket(listener);
+    remove(SERVER_SOCKET);
+
+    saveTasks(store);
+    freeStore(store);
+    setColor(GREEN);
+    printf("Task server stopped.\n");
+    setColor(RESET);
+    return 0;
+}
+
+// Comparison function used by qsort to sort tasks by their deadline date
+int compareDates(const void *a, const void *b) {
+    // Cast the generic pointers to Task pointers
+    const Task *taskA = (const Task *)a;
+    const Task *taskB = (const Task *)b;
+
+    // Positive if taskA is later than taskB, negative if earlier (ascending order)
+    return (taskA->deadlineDays > taskB->deadlineDays) - (taskA->deadlineDays < taskB->deadlineDays);
+}
+
+// Order of the index: deadline, then priority (High first), then ID
+static int compareOrder(const Task *a, const Task *b) {
+    int c = compareDates(a, b);
+    if (c == 0) c = (a->priority > b->priority) - (a->priority < b->priority);
+    if (c == 0) c = (a->id > b->id) - (a->id < b->id);
+    return c;
+}
+
+void initStore(TaskStore *store) {
+    memset(store, 0, sizeof(*store));
+    store->freeHead = -1;
+    store->nextId = 1;
+    recStoreInit(&store->files, &taskSchema, store);
+
+    // The built-in categories come first, in this order (CATEGORY_OTHER is the fourth)
+    internCategory(store, "Work");
+    internCategory(store, "Study");
+    internCategory(store, "Personal");
+    internCategory(store, "Other");
+}
+
+void freeStore(TaskStore *store) {
+    for (int i = 0; i < store->slabCount; i++) free(store->slabs[i]);
+    for (int c = 0; c < store->categoryCount; c++) free(store->categories[c].tasks.slots);
+    free(store->slabs);
+    free(store->nextFree);
+    free(store->idSlot);
+    free(store->order.slots);
+    free(store->open.slots);
+    free(store->categoryOf);
+    free(store->categories);
+    recStoreClose(&store->files);  // Closes the journal
+    memset(store, 0, sizeof(*store));
+}
+
+// Category ID of a name, matched ignoring case; a new name is added to the table.
+// Returns -1 if out of memory.
+int internCategory(TaskStore *store, const char *name) {
+    static const struct { const char *name; int color; } builtIn[] = {
+        {"Work", YELLOW}, {"Study", BLUE}, {"Personal", MAGENTA}, {"Other", GRAY}
+    };
+
+    if (name[0] == '\0' && store->categoryCount > CATEGORY_OTHER) return CATEGORY_OTHER;
+    for (int c = 0; c < store->categoryCount; c++)
+        if (strcasecmp(store->categories[c].name, name) == 0) return c;
+
+    Category *categories = realloc(store->categories, (store->categoryCount + 1) * sizeof(Category));
+    if (!categories) return -1;
+    store->categories = categories;
+
+    Category *cat = &categories[store->categoryCount];
+    memset(cat, 0, sizeof(*cat));
+    snprintf(cat->name, sizeof(cat->name), "%s", name);
+    cat->color = GRAY;  // User-defined categories are shown like "Other"
+    for (size_t i = 0; i < sizeof(builtIn) / sizeof(builtIn[0]); i++)
+        if (strcasecmp(builtIn[i].name, name) == 0) cat->color = builtIn[i].color;
+    return store->categoryCount++;
+}
+
+// The task in a slot
+Task *taskAt(TaskStore *store, int slot) {
+    return &store->slabs[slot / TASK_SLAB][slot % TASK_SLAB];
+}
+
+// Slot of the task with this ID, or -1
+int findTask(TaskStore *store, int id) {
+    if (id <= 0 || id >= store->idCapacity) return -1;
+    return store->idSlot[id];
+}
+
+// Make room for IDs up to id; returns 1 on success
+static int growIds(TaskStore *store, int id) {
+    if (id < store->idCapacity) return 1;
+
+    int capacity = store->idCapacity ? store->idCapacity : TASK_SLAB;
+    while (capacity <= id) capacity *= 2;
+    int *idSlot = realloc(store->idSlot, capacity * sizeof(int));
+    if (!idSlot) return 0;
+
+    for (int i = store->idCapacity; i < capacity; i++) idSlot[i] = -1;
+    store->idSlot = idSlot;
+    store->idCapacity = capacity;
+    return 1;
+}
+
+// A slot for a new task: a deleted one from the free list, or the next one
+// (allocating a new slab when the last one is full); -1 if out of memory
+int allocSlot(TaskStore *store) {
+    if (store->freeHead >= 0) {
+        int slot = store->freeHead;
+        store->freeHead = store->nextFree[slot];
+        return slot;
+    }
+
+    if (store->used == store->slabCount * TASK_SLAB) {
+        int slots = (store->slabCount + 1) * TASK_SLAB;
+        Task **slabs = realloc(store->slabs, (store->slabCount + 1) * sizeof(Task *));
+        if (!slabs) return -1;
+        store->slabs = slabs;
+
+        int *nextFree = realloc(store->nextFree, slots * sizeof(int));
+        if (nextFree) store->nextFree = nextFree;
+        int *categoryOf = realloc(store->categoryOf, slots * sizeof(int));
+        if (categoryOf) store->categoryOf = categoryOf;
+        Task *slab = malloc(TASK_SLAB * sizeof(Task));
+        if (!nextFree || !categoryOf || !slab) {
+            free(slab);
+            return -1;
+        }
+        store->slabs[store->slabCount++] = slab;
+    }
+    return store->used++;
+}
+
+// Add a copy of a task record (see copyTask); a task without an ID, or with one that
+// is taken, gets the next ID. ordered = 0 leaves the order index to rebuildOrder.
+// Returns the slot of the task, or -1 if it is invalid or out of memory.
+int storeAdd(TaskStore *store, const void *data, size_t size, int ordered) {
+    Task task;
+    if (!copyTask(&task, data, size)) return -1;
+    if (task.id <= 0 || findTask(store, task.id) >= 0) task.id = store->nextId;
+    if (!growIds(store, task.id)) return -1;
+
+    int category = internCategory(store, task.category);
+    if (category < 0) return -1;
+
+    int slot = allocSlot(store);
+    if (slot < 0) return -1;
+
+    *taskAt(store, slot) = task;
+    store->categoryOf[slot] = category;
+    if (ordered && !orderInsert(store, slot)) {
+        taskAt(store, slot)->id = 0;
+        store->nextFree[slot] = store->freeHead;
+        store->freeHead = slot;
+        return -1;
+    }
+
+    store->idSlot[task.id] = slot;
+    if (task.id >= store->nextId) store->nextId = task.id + 1;
+    store->count++;
+    markDirty(store, slot);  // A reused slot is rewritten, a new one appended
+    return slot;
+}
+
+// Delete the task in slot: O(1) in the store (the slot goes on the free list, no task is moved)
+void storeRemove(TaskStore *store, int slot) {
+    Task *t = taskAt(store, slot);
+    orderRemove(store, slot);
+    store->idSlot[t->id] = -1;
+    t->id = 0;  // Marks the slot free (saveTasks skips it)
+    store->nextFree[slot] = store->freeHead;
+    store->freeHead = slot;
+    store->count--;
+    markDirty(store, slot);
+}
+
+// Remember that a slot must be written at the next save. Slots past the end of
+// tasks.dat are appended anyway, so only the ones already in the file are listed.
+void markDirty(TaskStore *store, int slot) {
+    recStoreMarkDirty(&store->files, slot);
+}
+
+// Make room for one more slot in an index; returns 1 on success
+static int indexReserve(OrderIndex *index) {
+    if (index->count < index->capacity) return 1;
+
+    int capacity = index->capacity ? index->capacity * 2 : 16;
+    int *slots = realloc(index->slots, capacity * sizeof(int));
+    if (!slots) return 0;
+    index->slots = slots;
+    index->capacity = capacity;
+    return 1;
+}
+
+// Position of slot in an index, or the position it belongs at
+static int indexSearch(TaskStore *store, const OrderIndex *index, int slot) {
+    const Task *t = taskAt(store, slot);
+    int lo = 0, hi = index->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (compareOrder(taskAt(store, index->slots[mid]), t) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Binary search for the place of slot, then one memmove; room must be reserved
+static void indexInsert(TaskStore *store, OrderIndex *index, int slot) {
+    int pos = indexSearch(store, index, slot);
+    memmove(&index->slots[pos + 1], &index->slots[pos], (index->count - pos) * sizeof(int));
+    index->slots[pos] = slot;
+    index->count++;
+}
+
+static void indexRemove(TaskStore *store, OrderIndex *index, int slot) {
+    int pos = indexSearch(store, index, slot);
+    if (pos >= index->count || index->slots[pos] != slot) return;
+    memmove(&index->slots[pos], &index->slots[pos + 1], (index->count - pos - 1) * sizeof(int));
+    index->count--;
+}
+
+// Put a slot into the ordered index, the list of its category and (while it is
+// not completed) the deadline index; returns 0 if out of memory
+int orderInsert(TaskStore *store, int slot) {
+    OrderIndex *bucket = &store->categories[store->categoryOf[slot]].tasks;
+    int open = !taskAt(store, slot)->completed;
+    if (!indexReserve(&store->order) || !indexReserve(bucket) || (open && !indexReserve(&store->open)))
+        return 0;
+
+    indexInsert(store, &store->order, slot);
+    indexInsert(store, bucket, slot);
+    if (open) indexInsert(store, &store->open, slot);
+    return 1;
+}
+
+// Take a slot out of the ordered indexes; its task must not have changed since it was inserted
+void orderRemove(TaskStore *store, int slot) {
+    indexRemove(store, &store->order, slot);
+    indexRemove(store, &store->categories[store->categoryOf[slot]].tasks, slot);
+    if (!taskAt(store, slot)->completed) indexRemove(store, &store->open, slot);
+}
+
+// Completing a task does not change its place in the order, but it leaves the deadline index
+void markCompleted(TaskStore *store, int slot) {
+    Task *t = taskAt(store, slot);
+    if (t->completed) return;
+    indexRemove(store, &store->open, slot);
+    t->completed = 1;
+    markDirty(store, slot);
+}
+
+// The store being sorted by rebuildOrder
+static TaskStore *sortStore;
+
+static int compareSlots(const void *a, const void *b) {
+    return compareOrder(taskAt(sortStore, *(const int *)a), taskAt(sortStore, *(const int *)b));
+}
+
+// Build the ordered indexes from scratch (after loading): one sort of all the tasks,
+// then every category list is filled in that order. Returns 0 if out of memory.
+int rebuildOrder(TaskStore *store) {
+    OrderIndex *order = &store->order;
+    order->count = 0;
+    store->open.count = 0;
+    for (int c = 0; c < store->categoryCount; c++) store->categories[c].tasks.count = 0;
+
+    for (int slot = 0; slot < store->used; slot++) {
+        if (taskAt(store, slot)->id == 0) continue;
+        if (!indexReserve(order)) return 0;
+        order->slots[order->count++] = slot;
+    }
+
+    sortStore = store;
+    if (order->count > 1) qsort(order->slots, order->count, sizeof(int), compareSlots);
+
+    for (int k = 0; k < order->count; k++) {
+        OrderIndex *bucket = &store->categories[store->categoryOf[order->slots[k]]].tasks;
+        if (!indexReserve(bucket)) return 0;
+        bucket->slots[bucket->count++] = order->slots[k];
+
+        if (taskAt(store, order->slots[k])->completed) continue;
+        if (!indexReserve(&store->open)) return 0;
+        store->open.slots[store->open.count++] = order->slots[k];
+    }
+    return 1;
+}
+
+// First position in the deadline index with a deadline on or after days
+static int openLowerBound(TaskStore *store, int days) {
+    int lo = 0, hi = store->open.count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (taskAt(store, store->open.slots[mid])->deadlineDays < days) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Open tasks with a deadline from fromDays to toDays (days since 1970-01-01, both
+// included), soonest first. *slots points into the deadline index: it stays valid
+// until the next change. Returns the number of tasks, in O(log N).
+int queryDeadlines(TaskStore *store, int fromDays, int toDays, const int **slots) {
+    if (toDays >= NO_DEADLINE) toDays = NO_DEADLINE - 1;  // Tasks without a date are never due
+    if (fromDays > toDays) return 0;
+
+    int first = openLowerBound(store, fromDays);
+    int end = openLowerBound(store, toDays + 1);
+    *slots = store->open.slots + first;
+    return end - first;
+}
+
+
+// Function to edit an existing task's details: description, deadline, and priority
+void editTask(Backend *b) {
+    ListRequest all = {-1, 0, 0, 0, 0};
+    Reply reply;
+
+    // Handle empty task list
+    if (request(b, REQ_LIST, &all, sizeof(all), &reply) != REPLY_OK) return;
+    if (reply.total == 0) {
+        setColor(RED);
+        printf("No tasks available to edit.\n");
+        setColor(RESET);
+        return;
+    }
+
+    // Ask user for the ID of the task to edit
+    int id;
+    setColor(YELLOW);
+    printf("Enter task ID to edit: ");
+    setColor(RESET);
+    scanf("%d", &id);
+    getchar(); // Clear newline character left in buffer
+
+    // Validate task ID input
+    if (request(b, REQ_GET, &id, sizeof(id), &reply) != REPLY_OK || reply.count != 1) {
+        setColor(RED);
+        printf("Invalid task ID!\n");
+        setColor(RESET);
+        return;
+    }
+
+    // Only the fields changed here are sent, so the edit does not undo what another
+    // user did to the task in the meantime
+    const Task *t = &((const TaskRow *)b->items)->task;
+    TaskEdit edit;
+    memset(&edit, 0, sizeof(edit));
+    edit.id = id;
+
+    // Show current description and ask for new one
+    setColor(YELLOW);
+    printf("Editing Task %d:\n", id);
+    printf("Current Description: %s\n", t->description);
+    printf("Enter new description (or press Enter to keep): ");
+    setColor(RESET);
+
+    char input[MAX_LENGTH];
+    fgets(input, MAX_LENGTH, stdin);
+    if (strcmp(input, "\n") != 0) {
+        input[strcspn(input, "\n")] = '\0';  // Remove newline
+        strcpy(edit.description, input);    // Update description
+    }
+
+    // Update deadline if new input is provided
+    setColor(YELLOW);
+    printf("Current Deadline: %s\n", t->deadline);
+    printf("Enter new deadline (YYYY-MM-DD) (or press Enter to keep): ");
+    setColor(RESET);
+    fgets(input, 20, stdin);
+    if (strcmp(input, "\n") != 0) {
+        input[strcspn(input, "\n")] = '\0';
+        strcpy(edit.deadline, input);
+    }
+
+    // Update priority if new valid number is provided
+    setColor(YELLOW);
+    printf("Current Priority: %d\n", t->priority);
+    printf("Enter new priority (1=High, 2=Medium, 3=Low) or 0 to keep: ");
+    setColor(RESET);
+    int newPriority;
+    scanf("%d", &newPriority);
+    getchar();  // Clear input buffer again
+    if (newPriority >= 1 && newPriority <= 3) {
+        edit.priority = newPriority;
+    }
+
+    request(b, REQ_EDIT, &edit, sizeof(edit), &reply);
+    if (!changeMade(&reply)) return;
+
+    setColor(GREEN);
+    printf("Task updated successfully!\n");
+    setColor(RESET);
+}
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+int daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;  // Count March as the first month, so the leap day ends the year
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Parse "YYYY-MM-DD" into days since 1970-01-01 (NO_DEADLINE if it is not a date)
+int parseDeadline(const char *dateStr) {
+    int year, month, day;
+    if (sscanf(dateStr, "%d-%d-%d", &year, &month, &day) != 3) return NO_DEADLINE;
+    if (year < 1 || year > 9999 || month < 1 || month > 12 || day < 1 || day > 31) return NO_DEADLINE;
+    return daysFromCivil(year, month, day);
+}
+
+// Work out deadlineDays once, whenever a task is added, edited or loaded
+void setDeadlineDays(Task *t) {
+    t->deadlineDays = parseDeadline(t->deadline);
+}
+
+// Today's local date in days since 1970-01-01
+int todayDays() {
+    time_t now = time(NULL);
+    struct tm *local = localtime(&now);
+    return daysFromCivil(local->tm_year + 1900, local->tm_mon + 1, local->tm_mday);
+}
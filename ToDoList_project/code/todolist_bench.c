@@ -0,0 +1,299 @@
+/*
+==============================================
+   To-Do List Benchmark - C
+==============================================
+
+Generates a synthetic tasks.dat and times the operations of todolist.c
+on it, through the same request handler the console and the server use:
+- generate (RecWriter) and load (loadTasks: mapping, slabs, categories,
+  ordered indexes)
+- one page of the task table, of all tasks and of a category, built with
+  its ANSI colors into a RenderBuffer (the write to the terminal is left
+  out), and the whole sorted list page by page
+- overdue / due-soon queries
+- add, edit, complete and delete
+- save: the incremental checkpoint, then a full rewrite of tasks.dat
+
+For the repeated operations it reports p50 / p90 / p99 / max latency and
+operations per second; at the end the record store counters (checkpoints,
+full rewrites, records written) and the peak memory.
+
+Every file is created in a working directory of its own (bench_data by
+default), so a real tasks.dat is never touched. The journal is synced on
+every change as in the real program, so the change latencies include the
+fsync.
+
+Usage:
+-----------------------------------
+gcc -O2 -o todolist_bench todolist_bench.c ../../Common/code/recfile.c ../../Common/code/journal.c ../../Common/code/recstore.c ../../Common/code/bench.c
+(on Windows add -lws2_32 -lpsapi)
+./todolist_bench                     100000 tasks, 1000 operations of each kind
+./todolist_bench --records 10000000  dataset size (up to 10 million)
+./todolist_bench --ops 5000          operations of each kind
+./todolist_bench --json              one JSON object per line, for tracking regressions
+./todolist_bench --dir DIR           where the files are created (default bench_data)
+./todolist_bench --generate-only     only write DIR/tasks.dat
+-----------------------------------
+*/
+
+#define TODOLIST_NO_MAIN
+#include "todolist.c"
+
+#include "../../Common/code/bench.h"
+
+#define DEFAULT_RECORDS 100000
+#define DEFAULT_OPS 1000
+#define MAX_RECORDS 10000000
+#define BENCH_CATEGORIES 8
+#define DEADLINE_SPAN 730  // Deadlines fall within this many days before or after today
+
+// Keeps the optimizer from dropping the work being timed
+static volatile long sink;
+
+// Small fixed-seed generator, so every run uses the same dataset
+static unsigned long long randomState = 88172645463325252ULL;
+
+static unsigned long nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return (unsigned long)(randomState >> 16);
+}
+
+static const char *categoryNames[BENCH_CATEGORIES] = {
+    "Work", "Study", "Personal", "Other", "Errands", "Health", "Finance", "Home"
+};
+
+static const char *words[16] = {
+    "Finish", "Review", "Call", "Email", "Buy", "Fix", "Plan", "Write",
+    "report", "groceries", "dentist", "slides", "thesis", "car", "budget", "garden"
+};
+
+// A random task with a deadline around today (a few with an unreadable date)
+static void makeTask(Task *t, int id, int today) {
+    memset(t, 0, sizeof(*t));
+    snprintf(t->description, sizeof(t->description), "%s %s #%d",
+             words[nextRandom() % 8], words[8 + nextRandom() % 8], id);
+
+    int year = today / 365 + 1970 + (int)(nextRandom() % 5) - 2;
+    if (nextRandom() % 100 == 0) strcpy(t->deadline, "someday");
+    else snprintf(t->deadline, sizeof(t->deadline), "%04d-%02d-%02d",
+                  year, (int)(nextRandom() % 12) + 1, (int)(nextRandom() % 28) + 1);
+    setDeadlineDays(t);
+
+    t->priority = (int)(nextRandom() % 3) + 1;
+    t->completed = nextRandom() % 5 == 0;
+    strcpy(t->category, categoryNames[nextRandom() % BENCH_CATEGORIES]);
+    t->id = id;
+}
+
+// Write tasks.dat with records tasks and no journal; returns 1 on success
+static int generateTasks(long records) {
+    RecWriter w;
+    Task t;
+    int today = todayDays();
+
+    remove(JOURNAL_FILE);
+    if (!recWriterOpen(&w, SAVE_FILE, RECTYPE_TASK, sizeof(Task), 0)) return 0;
+    for (long i = 0; i < records; i++) {
+        makeTask(&t, (int)i + 1, today);
+        recWriterAdd(&w, &t);
+    }
+    return recWriterClose(&w);
+}
+
+// Build one page of a list into out, as viewTasks does; returns the length of the list
+static int renderPage(Backend *b, RenderBuffer *out, int category, int offset, int today) {
+    ListRequest list = {category, 0, 0, offset, PAGE_ROWS};
+    Reply reply;
+
+    if (request(b, REQ_LIST, &list, sizeof(list), &reply) != REPLY_OK) return 0;
+    renderTaskHeader(out);
+    renderTaskRows(out, b, &reply, today);
+    renderColor(out, RESET);
+    sink += (long)out->length;
+    out->length = 0;
+    return reply.total;
+}
+
+// ID of a random task that is still in the store
+static int randomTask(TaskStore *store) {
+    for (;;) {
+        int id = (int)(nextRandom() % (unsigned long)(store->nextId - 1)) + 1;
+        if (findTask(store, id) >= 0) return id;
+    }
+}
+
+// Time one kind of change: every sample is one request
+static void benchChanges(Backend *b, const char *name, uint32_t op, long ops, int today) {
+    BenchTimer t;
+    Reply reply;
+    Task task;
+    TaskEdit edit;
+    int id;
+
+    benchInit(&t, name, ops);
+    for (long i = 0; i < ops && b->store->count > 0; i++) {
+        const void *payload = &id;
+        uint32_t length = sizeof(id);
+        if (op == OP_ADD) {
+            makeTask(&task, 0, today);
+            payload = &task;
+            length = sizeof(task);
+        } else if (op == REQ_EDIT) {
+            makeTask(&task, 0, today);
+            memset(&edit, 0, sizeof(edit));
+            edit.id = randomTask(b->store);
+            strcpy(edit.description, task.description);
+            strcpy(edit.deadline, task.deadline);
+            edit.priority = task.priority;
+            payload = &edit;
+            length = sizeof(edit);
+        } else {
+            id = randomTask(b->store);
+        }
+
+        double start = benchNow();
+        int status = request(b, op, payload, length, &reply);
+        autosave(b->store);
+        benchAdd(&t, benchNow() - start);
+        if (status != REPLY_OK) fprintf(stderr, " %s: request failed (%d)\n", name, status);
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+}
+
+int main(int argc, char *argv[]) {
+    long records = DEFAULT_RECORDS;
+    long ops = DEFAULT_OPS;
+    const char *dir = "bench_data";
+    int generateOnly = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) {
+            records = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            benchSetJson(1);
+        } else if (strcmp(argv[i], "--generate-only") == 0) {
+            generateOnly = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--records N] [--ops N] [--json] [--dir DIR] [--generate-only]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (records < 1) records = 1;
+    if (records > MAX_RECORDS) records = MAX_RECORDS;
+    if (ops < 1) ops = 1;
+
+    if (!benchEnterDir(dir)) {
+        fprintf(stderr, "Could not use the directory %s\n", dir);
+        return 1;
+    }
+    benchPrintHeader("todolist", records);
+
+    double start = benchNow();
+    if (!generateTasks(records)) {
+        fprintf(stderr, "Could not write %s/%s\n", dir, SAVE_FILE);
+        return 1;
+    }
+    benchReportOnce("generate", benchNow() - start, records);
+    if (generateOnly) return 0;
+
+    TaskStore store;
+    Backend backend = {&store, INVALID_SOCKET, {NULL, 0, 0}, NULL};
+    start = benchNow();
+    initStore(&store);
+    loadTasks(&store);
+    benchReportOnce("load", benchNow() - start, store.count);
+
+    RenderBuffer out = {NULL, 0, 0, -1};
+    int today = todayDays();
+    BenchTimer t;
+    useColor = 1;  // Build the table as it is built for a terminal
+
+    // A random page of the sorted list of all tasks, and of one category
+    benchInit(&t, "view_page", ops);
+    for (long i = 0; i < ops; i++) {
+        int offset = (int)(nextRandom() % (unsigned long)store.count) / PAGE_ROWS * PAGE_ROWS;
+        start = benchNow();
+        renderPage(&backend, &out, -1, offset, today);
+        benchAdd(&t, benchNow() - start);
+    }
+    benchReport(&t, PAGE_ROWS);
+    benchFree(&t);
+
+    benchInit(&t, "view_page_category", ops);
+    for (long i = 0; i < ops; i++) {
+        int category = (int)(nextRandom() % (unsigned long)store.categoryCount);
+        int total = store.categories[category].tasks.count;
+        int offset = total > 0 ? (int)(nextRandom() % (unsigned long)total) / PAGE_ROWS * PAGE_ROWS : 0;
+        start = benchNow();
+        renderPage(&backend, &out, category, offset, today);
+        benchAdd(&t, benchNow() - start);
+    }
+    benchReport(&t, PAGE_ROWS);
+    benchFree(&t);
+
+    // Every page of the sorted list, one after the other
+    start = benchNow();
+    for (int offset = 0, total = 1; offset < total; offset += PAGE_ROWS)
+        total = renderPage(&backend, &out, -1, offset, today);
+    benchReportOnce("view_all_pages", benchNow() - start, store.count);
+    useColor = 0;
+
+    // Overdue (the first page, as queryTasks shows it) and due in the next 7 days
+    benchInit(&t, "query_overdue", ops);
+    for (long i = 0; i < ops; i++) {
+        ListRequest list = {-1, INT_MIN, today - 1, 0, PAGE_ROWS};
+        Reply reply;
+        start = benchNow();
+        request(&backend, REQ_QUERY, &list, sizeof(list), &reply);
+        benchAdd(&t, benchNow() - start);
+        sink += reply.total;
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    benchInit(&t, "query_due_soon", ops);
+    for (long i = 0; i < ops; i++) {
+        int from = today + (int)(nextRandom() % DEADLINE_SPAN) - DEADLINE_SPAN / 2;
+        ListRequest list = {-1, from, from + 7, 0, PAGE_ROWS};
+        Reply reply;
+        start = benchNow();
+        request(&backend, REQ_QUERY, &list, sizeof(list), &reply);
+        benchAdd(&t, benchNow() - start);
+        sink += reply.total;
+    }
+    benchReport(&t, 1);
+    benchFree(&t);
+
+    // Changes; autosave is part of them, as in the menu loop
+    benchChanges(&backend, "add", OP_ADD, ops, today);
+    benchChanges(&backend, "edit", REQ_EDIT, ops, today);
+    benchChanges(&backend, "complete", OP_COMPLETE_TASK, ops, today);
+    benchChanges(&backend, "delete", OP_DELETE_TASK, ops, today);
+
+    long changes = store.files.changes;
+    start = benchNow();
+    saveTasks(&store);
+    benchReportOnce("save_changed", benchNow() - start, changes);
+
+    store.files.rewrite = 1;
+    start = benchNow();
+    saveTasks(&store);
+    benchReportOnce("save_full", benchNow() - start, store.used);
+
+    benchReportValue("checkpoints", store.files.checkpoints);
+    benchReportValue("full_rewrites", store.files.fullRewrites);
+    benchReportValue("records_written", store.files.recordsWritten);
+    benchReportValue("peak_rss_kb", benchPeakRssKb());
+
+    free(out.data);
+    free(backend.reply.data);
+    freeStore(&store);
+    return 0;
+}